@@ -0,0 +1,109 @@
+// Compares the per-object TransformComponent path against the batched transform kernels.
+// Usage: transform_benchmark [objectCount] [iterations]
+
+#include "transform.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace {
+
+    using Ocean::GameObjectBufferData;
+
+    struct Scene {
+        std::vector<glm::vec3> translations;
+        std::vector<glm::vec3> rotations;
+        std::vector<glm::vec3> scales;
+        std::vector<uint32_t> indices;
+    };
+
+    Scene makeScene(uint32_t objectCount) {
+        std::mt19937 rng{1234};
+        std::uniform_real_distribution<float> position{-100.f, 100.f};
+        std::uniform_real_distribution<float> angle{-6.3f, 6.3f};
+        std::uniform_real_distribution<float> size{0.1f, 4.f};
+
+        Scene scene;
+        for (uint32_t i = 0; i < objectCount; i++) {
+            scene.translations.emplace_back(position(rng), position(rng), position(rng));
+            scene.rotations.emplace_back(angle(rng), angle(rng), angle(rng));
+            scene.scales.emplace_back(size(rng), size(rng), size(rng));
+        }
+        scene.indices.resize(objectCount);
+        std::iota(scene.indices.begin(), scene.indices.end(), 0u);
+        return scene;
+    }
+
+    void computeReference(const Scene &scene, std::vector<GameObjectBufferData> &out) {
+        for (uint32_t index: scene.indices) {
+            Ocean::TransformComponent transform{
+                    scene.translations[index], scene.scales[index], scene.rotations[index]};
+            out[index].modelMatrix = transform.mat4();
+            out[index].normalMatrix = transform.normalMatrix();
+        }
+    }
+
+    template<typename Fn>
+    double objectsPerMs(const Scene &scene, int iterations, Fn &&fn) {
+        fn();  // warm up caches and page in the output
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            fn();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        return static_cast<double>(scene.indices.size()) * iterations / ms;
+    }
+
+    float maxError(const std::vector<GameObjectBufferData> &a, const std::vector<GameObjectBufferData> &b) {
+        float error = 0.f;
+        for (size_t i = 0; i < a.size(); i++) {
+            for (int column = 0; column < 4; column++) {
+                for (int row = 0; row < 4; row++) {
+                    error = std::max(error, std::abs(a[i].modelMatrix[column][row] - b[i].modelMatrix[column][row]));
+                    error = std::max(error, std::abs(a[i].normalMatrix[column][row] - b[i].normalMatrix[column][row]));
+                }
+            }
+        }
+        return error;
+    }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    uint32_t objectCount = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 100000;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 50;
+
+    Scene scene = makeScene(objectCount);
+    std::vector<GameObjectBufferData> reference(objectCount);
+    std::vector<GameObjectBufferData> scalar(objectCount);
+    std::vector<GameObjectBufferData> batched(objectCount);
+
+    auto runBatch = [&](auto kernel, std::vector<GameObjectBufferData> &out) {
+        kernel(scene.translations.data(),
+               scene.rotations.data(),
+               scene.scales.data(),
+               scene.indices.data(),
+               scene.indices.size(),
+               out.data());
+    };
+
+    double referenceRate = objectsPerMs(scene, iterations, [&]() { computeReference(scene, reference); });
+    double scalarRate = objectsPerMs(scene, iterations, [&]() { runBatch(Ocean::computeTransformsScalar, scalar); });
+    double batchedRate = objectsPerMs(scene, iterations, [&]() { runBatch(Ocean::computeTransforms, batched); });
+
+    std::cout << objectCount << " objects, " << iterations << " iterations\n";
+    std::cout << "TransformComponent:       " << referenceRate << " objects/ms\n";
+    std::cout << "computeTransformsScalar:  " << scalarRate << " objects/ms ("
+              << scalarRate / referenceRate << "x), max error " << maxError(reference, scalar) << "\n";
+    std::cout << "computeTransforms (" << Ocean::transformKernelName() << "): " << batchedRate << " objects/ms ("
+              << batchedRate / referenceRate << "x), max error " << maxError(reference, batched) << "\n";
+    return 0;
+}
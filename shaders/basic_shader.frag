@@ -1,61 +1,39 @@
 #version 450
 
+#extension GL_EXT_nonuniform_qualifier : require
+#extension GL_GOOGLE_include_directive : require
+
 layout (location = 0) in vec3 fragColor;
 layout (location = 1) in vec3 fragPosWorld;
 layout (location = 2) in vec3 fragNormalWorld;
 layout (location = 3) in vec2 fragUv;
+layout (location = 4) flat in uint fragMaterialIndex;
 
 layout (location = 0) out vec4 outColor;
 
-struct PointLight {
-  vec4 position; // ignore w
-  vec4 color; // w is intensity
-};
-
 layout(set = 0, binding = 0) uniform GlobalUbo {
   mat4 projection;
   mat4 view;
   mat4 invView;
   vec4 ambientLightColor; // w is intensity
-  PointLight pointLights[10];
-  int numLights;
+  vec4 clusterScale; // xy clusters per pixel, zw scale and bias of log view depth
+  uvec4 clusterCounts; // clusters per axis, w is the number of lights
 } ubo;
 
-layout (set = 1, binding = 1) uniform sampler2D diffuseMap;
+// texture table, partially bound so only registered textures are valid
+layout (set = 2, binding = 0) uniform sampler2D textures[];
 
-layout(push_constant) uniform Push {
-  mat4 modelMatrix;
-  mat4 normalMatrix;
-} push;
+#define LIGHT_SET 3
+#include "lighting.glsl"
 
 void main() {
   vec3 diffuseLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
   vec3 specularLight = vec3(0.0);
   vec3 surfaceNormal = normalize(fragNormalWorld);
-
-  vec3 cameraPosWorld = ubo.invView[3].xyz;
-  vec3 viewDirection = normalize(cameraPosWorld - fragPosWorld);
-
-  for (int i = 0; i < ubo.numLights; i++) {
-    PointLight light = ubo.pointLights[i];
-    vec3 directionToLight = light.position.xyz - fragPosWorld;
-    float attenuation = 1.0 / dot(directionToLight, directionToLight); // distance squared
-    directionToLight = normalize(directionToLight);
-
-    float cosAngIncidence = max(dot(surfaceNormal, directionToLight), 0);
-    vec3 intensity = light.color.xyz * light.color.w * attenuation;
-
-    diffuseLight += intensity * cosAngIncidence;
-
-    // specular lighting
-    vec3 halfAngle = normalize(directionToLight + viewDirection);
-    float blinnTerm = dot(surfaceNormal, halfAngle);
-    blinnTerm = clamp(blinnTerm, 0, 1);
-    blinnTerm = pow(blinnTerm, 512.0); // higher values -> sharper highlight
-    specularLight += intensity * blinnTerm;
-  }
+  float viewDepth = (ubo.view * vec4(fragPosWorld, 1.0)).z;
+  accumulatePointLights(fragPosWorld, surfaceNormal, viewDepth, diffuseLight, specularLight);
 
   // vec3 color = fragColor;
-  vec3 color = texture(diffuseMap, fragUv).xyz;
+  vec3 color = texture(textures[nonuniformEXT(fragMaterialIndex)], fragUv).xyz;
   outColor = vec4(diffuseLight * color + specularLight * fragColor, 1.0);
 }
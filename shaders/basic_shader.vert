@@ -9,36 +9,47 @@ layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec3 fragPosWorld;
 layout(location = 2) out vec3 fragNormalWorld;
 layout(location = 3) out vec2 fragUv;
+layout(location = 4) flat out uint fragMaterialIndex;
 
-struct PointLight {
-  vec4 position; // ignore w
-  vec4 color; // w is intensity
-};
+// must match depth_prepass.vert bit for bit, the depth equal test relies on it
+invariant gl_Position;
 
 layout(set = 0, binding = 0) uniform GlobalUbo {
   mat4 projection;
   mat4 view;
   mat4 invView;
   vec4 ambientLightColor; // w is intensity
-  PointLight pointLights[10];
-  int numLights;
+  vec4 clusterScale; // xy clusters per pixel, zw scale and bias of log view depth
+  uvec4 clusterCounts; // clusters per axis, w is the number of lights
 } ubo;
 
-layout(set = 1, binding = 0) uniform GameObjectBufferData {
+struct GameObjectData {
   mat4 modelMatrix;
   mat4 normalMatrix;
-} gameObject;
+};
 
-layout(push_constant) uniform Push {
-  mat4 modelMatrix;
-  mat4 normalMatrix;
-} push;
+layout(set = 1, binding = 0) readonly buffer GameObjectBuffer {
+  GameObjectData objects[];
+} gameObjects;
+
+struct InstanceData {
+  uint objectIndex;
+  uint materialIndex; // into the texture table
+};
+
+// one entry per drawn instance, batches start at their firstInstance
+layout(set = 1, binding = 1) readonly buffer InstanceBuffer {
+  InstanceData instances[];
+} instanceBuffer;
 
 void main() {
+  InstanceData instance = instanceBuffer.instances[gl_InstanceIndex];
+  GameObjectData gameObject = gameObjects.objects[instance.objectIndex];
   vec4 positionWorld = gameObject.modelMatrix * vec4(position, 1.0);
   gl_Position = ubo.projection * ubo.view * positionWorld;
   fragNormalWorld = normalize(mat3(gameObject.normalMatrix) * normal);
   fragPosWorld = positionWorld.xyz;
   fragColor = color;
   fragUv = uv;
+  fragMaterialIndex = instance.materialIndex;
 }
@@ -0,0 +1,51 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : require
+
+// Lights every covered pixel once from the G-buffer, with the lighting.glsl model basic_shader.frag
+// uses too
+
+layout (location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 invView;
+  vec4 ambientLightColor; // w is intensity
+  vec4 clusterScale; // xy clusters per pixel, zw scale and bias of log view depth
+  uvec4 clusterCounts; // clusters per axis, w is the number of lights
+} ubo;
+
+// G-buffer of this pixel, written by gbuffer.frag
+layout (input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput albedoInput;
+layout (input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput normalInput;
+layout (input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput depthInput;
+
+#define LIGHT_SET 2
+#include "lighting.glsl"
+
+// view space position from the depth of a perspective projection (Camera::setPerspectiveProjection)
+vec3 viewPosition(float depth) {
+  vec2 extent = vec2(ubo.clusterCounts.xy) / ubo.clusterScale.xy;
+  vec2 ndc = gl_FragCoord.xy / extent * 2.0 - 1.0;
+  float viewDepth = ubo.projection[3][2] / (depth - ubo.projection[2][2]);
+  return vec3(ndc.x * viewDepth / ubo.projection[0][0], ndc.y * viewDepth / ubo.projection[1][1], viewDepth);
+}
+
+void main() {
+  float depth = subpassLoad(depthInput).r;
+  if (depth >= 1.0) {
+    // nothing was drawn here, keep the clear color
+    discard;
+  }
+  vec4 albedo = subpassLoad(albedoInput);
+  vec3 surfaceNormal = normalize(subpassLoad(normalInput).xyz);
+  vec3 positionView = viewPosition(depth);
+  vec3 fragPosWorld = (ubo.invView * vec4(positionView, 1.0)).xyz;
+
+  vec3 diffuseLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
+  vec3 specularLight = vec3(0.0);
+  accumulatePointLights(fragPosWorld, surfaceNormal, positionView.z, diffuseLight, specularLight);
+
+  outColor = vec4(diffuseLight * albedo.xyz + specularLight * albedo.w, 1.0);
+}
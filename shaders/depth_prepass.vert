@@ -0,0 +1,41 @@
+#version 450
+
+// Depth only pass ahead of basic_shader, which then shades only the fragments that passed with
+// depthCompareOp EQUAL. The position has to be computed exactly like basic_shader.vert.
+
+layout(location = 0) in vec3 position;
+
+invariant gl_Position;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 invView;
+  vec4 ambientLightColor; // w is intensity
+  vec4 clusterScale; // xy clusters per pixel, zw scale and bias of log view depth
+  uvec4 clusterCounts; // clusters per axis, w is the number of lights
+} ubo;
+
+struct GameObjectData {
+  mat4 modelMatrix;
+  mat4 normalMatrix;
+};
+
+layout(set = 1, binding = 0) readonly buffer GameObjectBuffer {
+  GameObjectData objects[];
+} gameObjects;
+
+struct InstanceData {
+  uint objectIndex;
+  uint materialIndex;
+};
+
+layout(set = 1, binding = 1) readonly buffer InstanceBuffer {
+  InstanceData instances[];
+} instanceBuffer;
+
+void main() {
+  GameObjectData gameObject = gameObjects.objects[instanceBuffer.instances[gl_InstanceIndex].objectIndex];
+  vec4 positionWorld = gameObject.modelMatrix * vec4(position, 1.0);
+  gl_Position = ubo.projection * ubo.view * positionWorld;
+}
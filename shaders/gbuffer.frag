@@ -0,0 +1,25 @@
+#version 450
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Writes the surface attributes basic_shader.frag shades with, deferred_lighting.frag lights them
+
+layout (location = 0) in vec3 fragColor;
+layout (location = 1) in vec3 fragPosWorld;
+layout (location = 2) in vec3 fragNormalWorld;
+layout (location = 3) in vec2 fragUv;
+layout (location = 4) flat in uint fragMaterialIndex;
+
+layout (location = 0) out vec4 outAlbedo; // a is the specular strength
+layout (location = 1) out vec4 outNormal; // world space, w is unused
+
+// texture table, partially bound so only registered textures are valid
+layout (set = 2, binding = 0) uniform sampler2D textures[];
+
+void main() {
+  vec3 albedo = texture(textures[nonuniformEXT(fragMaterialIndex)], fragUv).xyz;
+  // the forward path tints highlights with the vertex color, the G-buffer keeps its brightness
+  float specular = clamp(dot(fragColor, vec3(1.0 / 3.0)), 0.0, 1.0);
+  outAlbedo = vec4(albedo, specular);
+  outNormal = vec4(normalize(fragNormalWorld), 0.0);
+}
@@ -0,0 +1,100 @@
+// Clustered point lighting shared by basic_shader.frag and deferred_lighting.frag, so the forward
+// and deferred paths shade alike. The including shader declares GlobalUbo as ubo and defines
+// LIGHT_SET, the descriptor set LightClusterGrid is bound to, before including this file.
+
+struct PointLight {
+  vec4 position; // w is range
+  vec4 color; // w is intensity
+  ivec4 shadow; // x is the shadow map or -1
+};
+
+struct ClusterRange {
+  uint offset;
+  uint count;
+};
+
+// light clusters, see LightClusterGrid
+layout(set = LIGHT_SET, binding = 0) readonly buffer LightBuffer {
+  PointLight lights[];
+} lightBuffer;
+
+layout(set = LIGHT_SET, binding = 1) readonly buffer ClusterBuffer {
+  ClusterRange clusters[];
+} clusterBuffer;
+
+layout(set = LIGHT_SET, binding = 2) readonly buffer LightIndexBuffer {
+  uint indices[];
+} lightIndexBuffer;
+
+// six layers per shadowed light, see ShadowSystem
+layout(set = LIGHT_SET, binding = 3) uniform sampler2DArrayShadow shadowMap;
+
+// near plane of the face projections, ShadowSystem::NEAR_PLANE
+const float SHADOW_NEAR_PLANE = 0.05;
+
+// forward, right and down of every cube face in ShadowSystem's order +X, -X, +Y, -Y, +Z, -Z
+const vec3 FACE_FORWARD[6] = vec3[](vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1));
+const vec3 FACE_RIGHT[6] = vec3[](vec3(0, 0, -1), vec3(0, 0, 1), vec3(1, 0, 0), vec3(1, 0, 0), vec3(1, 0, 0), vec3(-1, 0, 0));
+const vec3 FACE_DOWN[6] = vec3[](vec3(0, 1, 0), vec3(0, 1, 0), vec3(0, 0, -1), vec3(0, 0, 1), vec3(0, 1, 0), vec3(0, 1, 0));
+
+// fraction of the light reaching a point, looked up in the face of the light's shadow map the
+// point projects to
+float shadowFactor(PointLight light, vec3 positionWorld) {
+  vec3 offset = positionWorld - light.position.xyz;
+  vec3 extent = abs(offset);
+  int face = extent.x >= extent.y && extent.x >= extent.z ? (offset.x < 0.0 ? 1 : 0)
+            : extent.y >= extent.z ? (offset.y < 0.0 ? 3 : 2)
+            : (offset.z < 0.0 ? 5 : 4);
+  float depth = dot(offset, FACE_FORWARD[face]);
+  vec2 uv = vec2(dot(offset, FACE_RIGHT[face]), dot(offset, FACE_DOWN[face])) / depth * 0.5 + 0.5;
+  // depth of a perspective projection from the near plane to the light's range
+  float far = light.position.w;
+  float ndcDepth = (far - far * SHADOW_NEAR_PLANE / depth) / (far - SHADOW_NEAR_PLANE);
+  return texture(shadowMap, vec4(uv, float(light.shadow.x * 6 + face), ndcDepth));
+}
+
+// cluster of the current fragment at a view space depth
+uint clusterIndex(float viewDepth) {
+  uvec2 tile = min(uvec2(gl_FragCoord.xy * ubo.clusterScale.xy), ubo.clusterCounts.xy - 1);
+  uint slice = uint(max(log(viewDepth) * ubo.clusterScale.z + ubo.clusterScale.w, 0.0));
+  slice = min(slice, ubo.clusterCounts.z - 1);
+  return (slice * ubo.clusterCounts.y + tile.y) * ubo.clusterCounts.x + tile.x;
+}
+
+// adds the diffuse and specular light of every light in the fragment's cluster
+void accumulatePointLights(
+    vec3 fragPosWorld,
+    vec3 surfaceNormal,
+    float viewDepth,
+    inout vec3 diffuseLight,
+    inout vec3 specularLight) {
+  vec3 cameraPosWorld = ubo.invView[3].xyz;
+  vec3 viewDirection = normalize(cameraPosWorld - fragPosWorld);
+
+  ClusterRange cluster = clusterBuffer.clusters[clusterIndex(viewDepth)];
+  for (uint i = 0; i < cluster.count; i++) {
+    PointLight light = lightBuffer.lights[lightIndexBuffer.indices[cluster.offset + i]];
+    vec3 directionToLight = light.position.xyz - fragPosWorld;
+    float distanceSquared = dot(directionToLight, directionToLight);
+    // inverse square falloff windowed to reach zero at the light's range
+    float rangeRatio = distanceSquared / (light.position.w * light.position.w);
+    float window = clamp(1.0 - rangeRatio * rangeRatio, 0.0, 1.0);
+    float attenuation = window * window / max(distanceSquared, 0.0001);
+    if (light.shadow.x >= 0) {
+      attenuation *= shadowFactor(light, fragPosWorld);
+    }
+    directionToLight = normalize(directionToLight);
+
+    float cosAngIncidence = max(dot(surfaceNormal, directionToLight), 0);
+    vec3 intensity = light.color.xyz * light.color.w * attenuation;
+
+    diffuseLight += intensity * cosAngIncidence;
+
+    // specular lighting
+    vec3 halfAngle = normalize(directionToLight + viewDirection);
+    float blinnTerm = dot(surfaceNormal, halfAngle);
+    blinnTerm = clamp(blinnTerm, 0, 1);
+    blinnTerm = pow(blinnTerm, 512.0); // higher values -> sharper highlight
+    specularLight += intensity * blinnTerm;
+  }
+}
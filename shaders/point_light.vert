@@ -10,36 +10,37 @@ const vec2 OFFSETS[6] = vec2[](
 );
 
 layout (location = 0) out vec2 fragOffset;
-
-struct PointLight {
-  vec4 position; // ignore w
-  vec4 color; // w is intensity
-};
+layout (location = 1) flat out vec3 fragColor;
 
 layout(set = 0, binding = 0) uniform GlobalUbo {
   mat4 projection;
   mat4 view;
   mat4 invView;
   vec4 ambientLightColor; // w is intensity
-  PointLight pointLights[10];
-  int numLights;
+  vec4 clusterScale; // xy clusters per pixel, zw scale and bias of log view depth
+  uvec4 clusterCounts; // clusters per axis, w is the number of lights
 } ubo;
 
-layout(push_constant) uniform Push {
-  vec4 position;
-  vec4 color;
-  float radius;
-} push;
+struct LightData {
+  vec4 position; // w is radius
+  vec4 color; // w is intensity
+};
 
+// sorted back to front, one instance per light
+layout(set = 1, binding = 0) readonly buffer LightBuffer {
+  LightData lights[];
+} lightBuffer;
 
 void main() {
+  LightData light = lightBuffer.lights[gl_InstanceIndex];
   fragOffset = OFFSETS[gl_VertexIndex];
+  fragColor = light.color.xyz;
   vec3 cameraRightWorld = {ubo.view[0][0], ubo.view[1][0], ubo.view[2][0]};
   vec3 cameraUpWorld = {ubo.view[0][1], ubo.view[1][1], ubo.view[2][1]};
 
-  vec3 positionWorld = push.position.xyz
-    + push.radius * fragOffset.x * cameraRightWorld
-    + push.radius * fragOffset.y * cameraUpWorld;
+  vec3 positionWorld = light.position.xyz
+    + light.position.w * fragOffset.x * cameraRightWorld
+    + light.position.w * fragOffset.y * cameraUpWorld;
 
   gl_Position = ubo.projection * ubo.view * vec4(positionWorld, 1.0);
 }
\ No newline at end of file
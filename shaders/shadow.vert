@@ -0,0 +1,29 @@
+#version 450
+
+// Depth of shadow casters seen from one cube face of a point light, see ShadowSystem. There is
+// no fragment stage, depth bias is set on the pipeline.
+
+layout(location = 0) in vec3 position;
+
+layout(push_constant) uniform Push {
+  mat4 viewProjection; // of the face being rendered
+} push;
+
+struct GameObjectData {
+  mat4 modelMatrix;
+  mat4 normalMatrix;
+};
+
+layout(set = 0, binding = 0) readonly buffer GameObjectBuffer {
+  GameObjectData objects[];
+} gameObjects;
+
+// dense object index of every caster, the draw's firstInstance selects the face's range
+layout(set = 0, binding = 1) readonly buffer CasterBuffer {
+  uint objectIndices[];
+} casterBuffer;
+
+void main() {
+  GameObjectData gameObject = gameObjects.objects[casterBuffer.objectIndices[gl_InstanceIndex]];
+  gl_Position = push.viewProjection * gameObject.modelMatrix * vec4(position, 1.0);
+}
@@ -2,8 +2,12 @@
 
 #include "vulkan/buffer.hpp"
 #include "camera.hpp"
+#include "culling.hpp"
 #include "keyboard_movement_controller.hpp"
+#include "light_cluster_grid.hpp"
+#include "systems/deferred_lighting_system.hpp"
 #include "systems/point_light_system.hpp"
+#include "systems/shadow_system.hpp"
 #include "systems/simple_render_system.hpp"
 
 // libs
@@ -22,11 +26,11 @@
 
 namespace Ocean {
 
-    App::App():
+    App::App(const std::string &scenePath):
     window{WIDTH, HEIGHT, "Vulkan MacOS M1"},
     device{window},
-    renderer{window, device},
-    gameObjectManager{device},
+    renderer{window, device, jobSystem.getThreadCount()},
+    gameObjectManager{device, jobSystem},
     globalPool{}
     {
         globalPool =
@@ -35,18 +39,20 @@ namespace Ocean {
                         .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
                         .build();
 
-        // build frame descriptor pools
-        framePools.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
-        auto framePoolBuilder = DescriptorPool::Builder(device)
-                .setMaxSets(1000)
-                .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000)
-                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000)
-                .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
-        for (auto &framePool: framePools) {
-            framePool = framePoolBuilder.build();
-        }
-
-        loadGameObjects();
+        // sets are freed one by one as they go stale
+        descriptorCache = std::make_unique<DescriptorSetCache>(
+                device,
+                SwapChain::MAX_FRAMES_IN_FLIGHT,
+                DescriptorPool::Builder(device)
+                        .setMaxSets(1000)
+                        .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000)
+                        .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1000)
+                        .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 100)
+                        .addPoolSize(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 100)
+                        .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
+                        .build());
+
+        loadGameObjects(scenePath);
     }
 
     App::~App() = default;
@@ -65,7 +71,10 @@ namespace Ocean {
 
         auto globalSetLayout =
                 DescriptorSetLayout::Builder(device)
-                        .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
+                        .addBinding(
+                                0,
+                                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT)
                         .build();
 
         std::vector<VkDescriptorSet> globalDescriptorSets(SwapChain::MAX_FRAMES_IN_FLIGHT);
@@ -79,65 +88,208 @@ namespace Ocean {
         std::cout << "Alignment: " << device.properties.limits.minUniformBufferOffsetAlignment << "\n";
         std::cout << "atom size: " << device.properties.limits.nonCoherentAtomSize << "\n";
 
+        LightClusterGrid lightClusterGrid{device};
+        ShadowSystem shadowSystem{device, SHADOW_MAP_BUDGET, SHADOW_MAP_RESOLUTION};
         SimpleRenderSystem simpleRenderSystem{
                 device,
                 renderer.getSwapChainRenderPass(),
-                globalSetLayout->getDescriptorSetLayout()};
+                renderer.getDeferredRenderPass(),
+                globalSetLayout->getDescriptorSetLayout(),
+                gameObjectManager.getTextureTable().getSetLayout(),
+                lightClusterGrid.getSetLayout()};
+        DeferredLightingSystem deferredLightingSystem{
+                device,
+                renderer.getDeferredRenderPass(),
+                globalSetLayout->getDescriptorSetLayout(),
+                lightClusterGrid.getSetLayout()};
         PointLightSystem pointLightSystem{
                 device,
                 renderer.getSwapChainRenderPass(),
+                renderer.getDeferredRenderPass(),
                 globalSetLayout->getDescriptorSetLayout()};
         Camera camera{};
 
-        auto &viewerObject = gameObjectManager.createGameObject();
-        viewerObject.transform.translation.z = -2.5f;
+        auto viewerObject = gameObjectManager.createGameObject();
+        viewerObject.translation().z = -2.5f;
         KeyboardMovementController cameraController{};
 
+        // M cycles through direct, indirect and GPU culled draws, P toggles the depth pre-pass and
+        // O occlusion culling of GPU culled draws, G switches between forward and deferred
+        // shading, the CPU cost of each is printed every second
+        bool submissionKeyDown = false;
+        bool prepassKeyDown = false;
+        bool occlusionKeyDown = false;
+        bool shadingKeyDown = false;
+        ShadingPath shadingPath = ShadingPath::Forward;
+        float statsTime = 0.f;
+
         auto currentTime = std::chrono::high_resolution_clock::now();
         while (!window.shouldClose()) {
             glfwPollEvents();
+            jobSystem.runMainThreadJobs();
+
+            bool keyDown = glfwGetKey(window.getGLFWwindow(), GLFW_KEY_M) == GLFW_PRESS;
+            if (keyDown && !submissionKeyDown) {
+                using DrawSubmission = SimpleRenderSystem::DrawSubmission;
+                switch (simpleRenderSystem.getDrawSubmission()) {
+                    case DrawSubmission::Direct:
+                        simpleRenderSystem.setDrawSubmission(DrawSubmission::Indirect);
+                        break;
+                    case DrawSubmission::Indirect:
+                        simpleRenderSystem.setDrawSubmission(DrawSubmission::GpuCulled);
+                        break;
+                    case DrawSubmission::GpuCulled:
+                        simpleRenderSystem.setDrawSubmission(DrawSubmission::Direct);
+                        break;
+                }
+                simpleRenderSystem.resetRecordStats();
+                statsTime = 0.f;
+            }
+            submissionKeyDown = keyDown;
+
+            keyDown = glfwGetKey(window.getGLFWwindow(), GLFW_KEY_P) == GLFW_PRESS;
+            if (keyDown && !prepassKeyDown) {
+                simpleRenderSystem.setDepthPrepass(!simpleRenderSystem.isDepthPrepassEnabled());
+                simpleRenderSystem.resetRecordStats();
+                statsTime = 0.f;
+            }
+            prepassKeyDown = keyDown;
+
+            keyDown = glfwGetKey(window.getGLFWwindow(), GLFW_KEY_O) == GLFW_PRESS;
+            if (keyDown && !occlusionKeyDown) {
+                simpleRenderSystem.setOcclusionCulling(!simpleRenderSystem.isOcclusionCullingEnabled());
+                simpleRenderSystem.resetRecordStats();
+                statsTime = 0.f;
+            }
+            occlusionKeyDown = keyDown;
+
+            keyDown = glfwGetKey(window.getGLFWwindow(), GLFW_KEY_G) == GLFW_PRESS;
+            if (keyDown && !shadingKeyDown) {
+                shadingPath = shadingPath == ShadingPath::Forward ? ShadingPath::Deferred : ShadingPath::Forward;
+                simpleRenderSystem.resetRecordStats();
+                statsTime = 0.f;
+            }
+            shadingKeyDown = keyDown;
 
             auto newTime = std::chrono::high_resolution_clock::now();
             float frameTime =
                     std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
             currentTime = newTime;
 
+            statsTime += frameTime;
+            if (statsTime >= 1.f) {
+                const auto &stats = simpleRenderSystem.getRecordStats();
+                if (stats.frames > 0) {
+                    auto submission = simpleRenderSystem.getDrawSubmission();
+                    const bool deferred = shadingPath == ShadingPath::Deferred;
+                    std::cout << (deferred ? "Deferred, " : "Forward, ")
+                              << (submission == SimpleRenderSystem::DrawSubmission::Direct ? "direct"
+                                  : submission == SimpleRenderSystem::DrawSubmission::Indirect ? "indirect"
+                                  : "GPU culled")
+                              << " draws"
+                              << (!deferred && simpleRenderSystem.isDepthPrepassEnabled() ? " with depth pre-pass" : "")
+                              << ": " << 1000.f * statsTime / stats.frames << " ms per frame, "
+                              << stats.milliseconds / stats.frames << " ms recording per frame, "
+                              << stats.drawCalls << " draw calls";
+                    const auto &cullStats = simpleRenderSystem.getCullStats();
+                    if (submission == SimpleRenderSystem::DrawSubmission::GpuCulled) {
+                        std::cout << ", " << stats.gpuVisibleInstances << " of " << cullStats.drawn
+                                  << " instances visible";
+                        if (!deferred && simpleRenderSystem.isOcclusionCullingEnabled()) {
+                            std::cout << ", " << stats.gpuOccludedInstances << " occluded";
+                        }
+                    } else {
+                        std::cout << ", " << cullStats.tested << " tested, " << cullStats.culled << " culled, "
+                                  << cullStats.drawn << " drawn (" << cullKernelName() << ")";
+                    }
+                    std::cout << ", " << lightClusterGrid.getLightCount() << " lights in "
+                              << lightClusterGrid.getLightIndexCount() << " cluster slots";
+                    const auto &shadowStats = shadowSystem.getStats();
+                    std::cout << ", " << shadowStats.shadowedLights << " of " << shadowSystem.getShadowMapBudget()
+                              << " shadow maps, " << shadowStats.cachedFaces << " cached and "
+                              << shadowStats.compositedFaces << " composited faces, " << shadowStats.skippedFaces
+                              << " skipped";
+                    // the cache has not started this frame yet, the count covers the previous one
+                    std::cout << ", " << descriptorCache->getWriteCount() << " descriptor writes, "
+                              << descriptorCache->size() << " cached sets\n";
+                }
+                simpleRenderSystem.resetRecordStats();
+                statsTime = 0.f;
+            }
+
             cameraController.moveInPlaneXZ(window.getGLFWwindow(), frameTime, viewerObject);
-            camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
+            auto viewerTransform = viewerObject.transform();
+            camera.setViewYXZ(viewerTransform.translation, viewerTransform.rotation);
 
             float aspect = renderer.getAspectRatio();
             camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
 
             if (auto commandBuffer = renderer.beginFrame()) {
                 int frameIndex = renderer.getFrameIndex();
-                framePools[frameIndex]->resetPool();
+                descriptorCache->beginFrame();
                 FrameInfo frameInfo{
                         frameIndex,
                         frameTime,
                         commandBuffer,
                         camera,
                         globalDescriptorSets[frameIndex],
-                        *framePools[frameIndex],
-                        gameObjectManager.gameObjects};
+                        *descriptorCache,
+                        gameObjectManager,
+                        jobSystem,
+                        renderer};
+                frameInfo.shadingPath = shadingPath;
 
                 // update
+                pointLightSystem.update(frameInfo);
+
+                // final step of update is updating the game objects buffer data, this also
+                // resolves world matrices for the hierarchy
+                // The render functions MUST not change a game objects transform data
+                gameObjectManager.updateBuffer(frameIndex);
+                shadowSystem.update(frameInfo);
+                lightClusterGrid.build(frameInfo, shadowSystem.getShadowMapInfo());
+                frameInfo.lightDescriptorSet = lightClusterGrid.getDescriptorSet();
+
                 GlobalUbo ubo{};
                 ubo.projection = camera.getProjection();
                 ubo.view = camera.getView();
                 ubo.inverseView = camera.getInverseView();
-                pointLightSystem.update(frameInfo, ubo);
+                lightClusterGrid.writeToUbo(ubo);
                 uboBuffers[frameIndex]->writeToBuffer(&ubo);
                 uboBuffers[frameIndex]->flush();
 
-                // final step of update is updating the game objects buffer data
-                // The render functions MUST not change a game objects transform data
-                gameObjectManager.updateBuffer(frameIndex);
-
-                // render
-                renderer.beginSwapChainRenderPass(commandBuffer);
-
-                // order here matters
-                simpleRenderSystem.renderGameObjects(frameInfo);
+                // compute work and the shadow maps have to be recorded outside the render pass
+                simpleRenderSystem.prepareFrame(frameInfo);
+                shadowSystem.render(frameInfo);
+
+                // render, every system records its draws into secondary command buffers
+                using RenderPassPhase = SwapChain::RenderPassPhase;
+                if (shadingPath == ShadingPath::Deferred) {
+                    // G-buffer, lighting, then the billboards, all in one render pass
+                    renderer.beginDeferredRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+                    simpleRenderSystem.renderGameObjects(frameInfo);
+                    renderer.nextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+                    deferredLightingSystem.render(frameInfo);
+                    renderer.nextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+                } else {
+                    // Occlusion culling splits the pass: what the first half draws is reduced into
+                    // the depth pyramid, which decides what else the second half draws
+                    const bool occlusionCulling = simpleRenderSystem.isOcclusionCullingActive();
+                    renderer.beginSwapChainRenderPass(
+                            commandBuffer,
+                            VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS,
+                            occlusionCulling ? RenderPassPhase::First : RenderPassPhase::Whole);
+
+                    // order here matters
+                    simpleRenderSystem.renderGameObjects(frameInfo);
+                    if (occlusionCulling) {
+                        renderer.endSwapChainRenderPass(commandBuffer);
+                        simpleRenderSystem.cullOccluded(frameInfo);
+                        renderer.beginSwapChainRenderPass(
+                                commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, RenderPassPhase::Second);
+                        simpleRenderSystem.renderDisoccluded(frameInfo);
+                    }
+                }
                 pointLightSystem.render(frameInfo);
 
                 renderer.endSwapChainRenderPass(commandBuffer);
@@ -146,50 +298,36 @@ namespace Ocean {
         }
 
         vkDeviceWaitIdle(device.device());
+
+        JobStats jobStats = jobSystem.getStats();
+        std::cout << "Job system: " << jobSystem.getThreadCount() << " threads, " << jobStats.jobsRun
+                  << " jobs run, " << jobStats.steals << " steals, " << jobStats.idleMilliseconds
+                  << " ms idle\n";
     }
 
-    void App::loadGameObjects() {
-        std::shared_ptr<Model> model =
-                Model::createModelFromFile(device, "models/bunny.obj");
-        auto &bunny = gameObjectManager.createGameObject();
-        bunny.model = model;
-        bunny.transform.translation = {-.5f, .5f, 0.f};
-        bunny.transform.scale = {.5f, .5f, .5f};
-        // Pi = atan(1)*4
-        bunny.transform.rotation = {0.0f, atan(1) * 4, atan(1) * 4};
-
-        model = Model::createModelFromFile(device, "models/dragon.obj");
-        auto &dragon = gameObjectManager.createGameObject();
-        dragon.model = model;
-        dragon.transform.translation = {.5f, .2f, 0.f};
-        dragon.transform.scale = {1.f, 1.f, 1.f};
-        dragon.transform.rotation = {PI, -PI / 2, 0.0f};
-
-        model = Model::createModelFromFile(device, "models/quad.obj");
-        std::shared_ptr<Texture> marbleTexture =
-                Texture::createTextureFromFile(device, "../textures/floor.png");
-        auto &floor = gameObjectManager.createGameObject();
-        floor.model = model;
-        floor.diffuseMap = marbleTexture;
-        floor.transform.translation = {0.f, .5f, 0.f};
-        floor.transform.scale = {6.f, 1.f, 6.f};
-
-        std::vector<glm::vec3> lightColors{
-                {2.f, .2f, .2f},
-                {2.f, 2.f, .2f},
-                {.2f, 2.f, 2.f},
-                {2.f, 2.f, 2.f}  //
-        };
-
-        for (int i = 0; i < lightColors.size(); i++) {
-            auto &pointLight = gameObjectManager.makePointLight(1.0f);
-            pointLight.color = lightColors[i];
-            auto rotateLight = glm::rotate(
-                    glm::mat4(1.f),
-                    (i * glm::two_pi<float>()) / lightColors.size(),
-                    {0.f, -1.f, 0.f});
-            pointLight.transform.translation = glm::vec3(rotateLight * glm::vec4(-1.f, -1.f, -1.f, 1.f));
+    void App::loadGameObjects(const std::string &scenePath) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        SceneFile scene{scenePath};
+
+        std::vector<ModelHandle> models;
+        models.reserve(scene.getModelCount());
+        for (uint32_t i = 0; i < scene.getModelCount(); i++) {
+            std::shared_ptr<Model> model = Model::createModelFromFile(device, scene.getModelPath(i));
+            models.push_back(gameObjectManager.registerModel(model));
         }
+        std::vector<TextureHandle> textures;
+        textures.reserve(scene.getTextureCount());
+        for (uint32_t i = 0; i < scene.getTextureCount(); i++) {
+            std::shared_ptr<Texture> texture = Texture::createTextureFromFile(device, scene.getTexturePath(i));
+            textures.push_back(gameObjectManager.registerTexture(texture));
+        }
+
+        gameObjectManager.loadScene(scene, models, textures);
+
+        float loadTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                std::chrono::high_resolution_clock::now() - startTime).count();
+        std::cout << "Loaded " << scene.getObjectCount() << " game objects from " << scenePath << " in "
+                  << loadTime << " ms\n";
     }
 
 }  // namespace Ocean
@@ -3,11 +3,13 @@
 #include "vulkan/descriptors.hpp"
 #include "vulkan/device.hpp"
 #include "game_object.hpp"
+#include "job_system.hpp"
 #include "renderer.hpp"
 #include "window.hpp"
 
 // std
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace Ocean {
@@ -16,8 +18,12 @@ namespace Ocean {
         static constexpr int WIDTH = 800;
         static constexpr int HEIGHT = 600;
         static constexpr float PI = 3.1415926;
+        static constexpr const char *DEFAULT_SCENE = "../scenes/default.oscene";
+        // point lights given a shadow map each frame, and the width and height of a cube face
+        static constexpr uint32_t SHADOW_MAP_BUDGET = 4;
+        static constexpr uint32_t SHADOW_MAP_RESOLUTION = 512;
 
-        App();
+        explicit App(const std::string &scenePath = DEFAULT_SCENE);
         ~App();
         App(const App &) = delete;
         App &operator=(const App &) = delete;
@@ -25,13 +31,14 @@ namespace Ocean {
 
     private:
         Window window;
+        JobSystem jobSystem;
         Device device;
         OceanRenderer renderer;
         // order of declarations matters
         std::unique_ptr<DescriptorPool> globalPool;
-        std::vector<std::unique_ptr<DescriptorPool>> framePools;
+        std::unique_ptr<DescriptorSetCache> descriptorCache;
         GameObjectManager gameObjectManager;
 
-        void loadGameObjects();
+        void loadGameObjects(const std::string &scenePath);
     };
 }  // namespace lve
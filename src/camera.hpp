@@ -1,5 +1,7 @@
 #pragma once
 
+#include "geometry.hpp"
+
 // libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -31,9 +33,19 @@ namespace Ocean {
 
         [[nodiscard]] glm::vec3 getPosition() const { return glm::vec3(inverseViewMatrix[3]); }
 
+        // view space depths of the clipping planes of the last projection set
+        [[nodiscard]] float getNear() const { return nearPlane; }
+
+        [[nodiscard]] float getFar() const { return farPlane; }
+
+        // normalized planes of projection * view
+        [[nodiscard]] Frustum getFrustum() const { return Frustum::fromViewProjection(projectionMatrix * viewMatrix); }
+
     private:
         glm::mat4 projectionMatrix{1.f};
         glm::mat4 viewMatrix{1.f};
         glm::mat4 inverseViewMatrix{1.f};
+        float nearPlane = 0.f;
+        float farPlane = 1.f;
     };
 }  // namespace Ocean
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "culling.hpp"
+
+#include "simd_lanes.hpp"
+
+namespace Ocean {
+
+    namespace {
+
+        template<typename L>
+        void cullSpheresImpl(
+                const float *centersX,
+                const float *centersY,
+                const float *centersZ,
+                const float *radii,
+                size_t count,
+                const Frustum &frustum,
+                uint8_t *visible) {
+            using F = typename L::F;
+            constexpr int W = L::width;
+
+            F planeX[6], planeY[6], planeZ[6], planeW[6];
+            for (int p = 0; p < 6; p++) {
+                planeX[p] = L::set1(frustum.planes[p].x);
+                planeY[p] = L::set1(frustum.planes[p].y);
+                planeZ[p] = L::set1(frustum.planes[p].z);
+                planeW[p] = L::set1(frustum.planes[p].w);
+            }
+
+            size_t base = 0;
+            for (; base + W <= count; base += W) {
+                F x = L::loadUnaligned(centersX + base);
+                F y = L::loadUnaligned(centersY + base);
+                F z = L::loadUnaligned(centersZ + base);
+                F radius = L::loadUnaligned(radii + base);
+
+                // signed distance of the sphere's far side to the closest plane, negative if the
+                // whole sphere is outside any one plane
+                F nearest{};
+                for (int p = 0; p < 6; p++) {
+                    F distance = L::add(
+                            L::add(L::mul(planeX[p], x), L::mul(planeY[p], y)),
+                            L::add(L::mul(planeZ[p], z), planeW[p]));
+                    distance = L::add(distance, radius);
+                    nearest = p == 0 ? distance : L::min(nearest, distance);
+                }
+
+                int outside = L::negativeMask(nearest);
+                for (int lane = 0; lane < W; lane++) {
+                    visible[base + lane] = static_cast<uint8_t>(((outside >> lane) & 1) ^ 1);
+                }
+            }
+
+            if constexpr (W > 1) {
+                cullSpheresImpl<ScalarLanes>(
+                        centersX + base,
+                        centersY + base,
+                        centersZ + base,
+                        radii + base,
+                        count - base,
+                        frustum,
+                        visible + base);
+            }
+        }
+
+    }  // namespace
+
+    void cullSpheres(
+            const float *centersX,
+            const float *centersY,
+            const float *centersZ,
+            const float *radii,
+            size_t count,
+            const Frustum &frustum,
+            uint8_t *visible) {
+#ifdef OCEAN_SIMD_SCALAR_ONLY
+        cullSpheresImpl<ScalarLanes>(centersX, centersY, centersZ, radii, count, frustum, visible);
+#else
+        cullSpheresImpl<SimdLanes>(centersX, centersY, centersZ, radii, count, frustum, visible);
+#endif
+    }
+
+    void cullSpheresScalar(
+            const float *centersX,
+            const float *centersY,
+            const float *centersZ,
+            const float *radii,
+            size_t count,
+            const Frustum &frustum,
+            uint8_t *visible) {
+        cullSpheresImpl<ScalarLanes>(centersX, centersY, centersZ, radii, count, frustum, visible);
+    }
+
+    const char *cullKernelName() {
+#ifdef OCEAN_SIMD_SCALAR_ONLY
+        return ScalarLanes::name;
+#else
+        return SimdLanes::name;
+#endif
+    }
+
+}  // namespace Ocean
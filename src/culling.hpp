@@ -0,0 +1,38 @@
+#pragma once
+
+#include "geometry.hpp"
+
+// std
+#include <cstddef>
+#include <cstdint>
+
+namespace Ocean {
+
+    // Frustum tests count bounding spheres given as separate component arrays and writes 1 to
+    // visible[i] if sphere i is at least partly inside, 0 otherwise. Spheres with a negative
+    // infinite radius are never visible. Planes have to be normalized. Spheres are tested
+    // several at a time using the widest SIMD instruction set the translation unit was
+    // compiled for.
+    void cullSpheres(
+            const float *centersX,
+            const float *centersY,
+            const float *centersZ,
+            const float *radii,
+            size_t count,
+            const Frustum &frustum,
+            uint8_t *visible);
+
+    // same kernel restricted to one sphere per step, for platforms without SIMD and for comparison
+    void cullSpheresScalar(
+            const float *centersX,
+            const float *centersY,
+            const float *centersZ,
+            const float *radii,
+            size_t count,
+            const Frustum &frustum,
+            uint8_t *visible);
+
+    // name of the instruction set cullSpheres was built with, e.g. "AVX2"
+    const char *cullKernelName();
+
+}  // namespace Ocean
@@ -0,0 +1,265 @@
+#include "depth_pyramid.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace Ocean {
+
+    namespace {
+
+        constexpr VkFormat PYRAMID_FORMAT = VK_FORMAT_R32_SFLOAT;
+        constexpr uint32_t WORKGROUP_SIZE = 8;  // local_size_x and local_size_y of depth_pyramid.comp
+
+        uint32_t previousPowerOfTwo(uint32_t value) {
+            uint32_t result = 1;
+            while (result * 2 <= value) {
+                result *= 2;
+            }
+            return result;
+        }
+
+        // makes every compute shader write recorded so far visible to the compute shaders after it
+        void computeBarrier(VkCommandBuffer commandBuffer) {
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(
+                    commandBuffer,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    0,
+                    1,
+                    &barrier,
+                    0,
+                    nullptr,
+                    0,
+                    nullptr);
+        }
+
+    }  // namespace
+
+    DepthPyramid::DepthPyramid(Device &device) : device{device} {
+        createPipeline();
+        createSampler();
+    }
+
+    DepthPyramid::~DepthPyramid() {
+        destroyImage();
+        vkDestroySampler(device.device(), sampler, nullptr);
+        vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+    }
+
+    void DepthPyramid::createPipeline() {
+        setLayout =
+                DescriptorSetLayout::Builder(device)
+                        .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .build();
+
+        VkDescriptorSetLayout descriptorSetLayout = setLayout->getDescriptorSetLayout();
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 0;
+        pipelineLayoutInfo.pPushConstantRanges = nullptr;
+        if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
+
+        pipeline = std::make_unique<ComputePipeline>(device, "shaders/depth_pyramid.comp.spv", pipelineLayout);
+    }
+
+    void DepthPyramid::createSampler() {
+        // culling reads single texels of a chosen level, nothing is filtered
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = samplerInfo.addressModeU;
+        samplerInfo.addressModeW = samplerInfo.addressModeU;
+        samplerInfo.mipLodBias = 0.0f;
+        samplerInfo.maxAnisotropy = 1.0f;
+        samplerInfo.minLod = 0.0f;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+        if (vkCreateSampler(device.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create sampler!");
+        }
+    }
+
+    void DepthPyramid::resize(VkExtent2D newDepthExtent) {
+        if (image != VK_NULL_HANDLE && newDepthExtent.width == depthExtent.width &&
+            newDepthExtent.height == depthExtent.height) {
+            return;
+        }
+        destroyImage();
+        depthExtent = newDepthExtent;
+        createImage();
+    }
+
+    void DepthPyramid::createImage() {
+        extent = {previousPowerOfTwo(depthExtent.width), previousPowerOfTwo(depthExtent.height)};
+        levelCount = 1;
+        while ((std::max(extent.width, extent.height) >> levelCount) > 0) {
+            levelCount++;
+        }
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = extent.width;
+        imageInfo.extent.height = extent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = levelCount;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = PYRAMID_FORMAT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = PYRAMID_FORMAT;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = levelCount;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+        if (vkCreateImageView(device.device(), &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create depth pyramid image view!");
+        }
+
+        levelViews.resize(levelCount);
+        for (uint32_t level = 0; level < levelCount; level++) {
+            viewInfo.subresourceRange.baseMipLevel = level;
+            viewInfo.subresourceRange.levelCount = 1;
+            if (vkCreateImageView(device.device(), &viewInfo, nullptr, &levelViews[level]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create depth pyramid image view!");
+            }
+        }
+
+        // the image is sampled and stored in the same layout, so it is transitioned once here.
+        // Culling may bind it before the first build
+        VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = viewInfo.subresourceRange;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = levelCount;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                0,
+                0,
+                nullptr,
+                0,
+                nullptr,
+                1,
+                &barrier);
+        device.endSingleTimeCommands(commandBuffer);
+
+        built = false;
+    }
+
+    void DepthPyramid::destroyImage() {
+        if (image == VK_NULL_HANDLE) return;
+
+        // culling dispatches of frames in flight may still sample it
+        device.deferDestruction(
+                [device = device.device(),
+                 views = std::move(levelViews),
+                 imageView = imageView,
+                 image = image,
+                 imageMemory = imageMemory]() {
+                    for (auto view: views) {
+                        vkDestroyImageView(device, view, nullptr);
+                    }
+                    vkDestroyImageView(device, imageView, nullptr);
+                    vkDestroyImage(device, image, nullptr);
+                    vkFreeMemory(device, imageMemory, nullptr);
+                });
+        levelViews.clear();
+        imageView = VK_NULL_HANDLE;
+        image = VK_NULL_HANDLE;
+        imageMemory = VK_NULL_HANDLE;
+        built = false;
+    }
+
+    void DepthPyramid::build(
+            VkCommandBuffer commandBuffer,
+            VkImageView depthImageView,
+            const glm::mat4 &depthViewProjection,
+            DescriptorSetCache &descriptorCache) {
+        assert(image != VK_NULL_HANDLE && "Cannot build depth pyramid before resize");
+
+        // earlier dispatches may still be reading the previous contents
+        computeBarrier(commandBuffer);
+        pipeline->bind(commandBuffer);
+        for (uint32_t level = 0; level < levelCount; level++) {
+            VkDescriptorImageInfo sourceInfo{};
+            sourceInfo.sampler = sampler;
+            sourceInfo.imageView = level == 0 ? depthImageView : levelViews[level - 1];
+            sourceInfo.imageLayout =
+                    level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+            VkDescriptorImageInfo destinationInfo{};
+            destinationInfo.imageView = levelViews[level];
+            destinationInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+            VkDescriptorSet descriptorSet;
+            DescriptorWriter(*setLayout, descriptorCache)
+                    .writeImage(0, &sourceInfo)
+                    .writeImage(1, &destinationInfo)
+                    .build(descriptorSet);
+            vkCmdBindDescriptorSets(
+                    commandBuffer,
+                    VK_PIPELINE_BIND_POINT_COMPUTE,
+                    pipelineLayout,
+                    0,
+                    1,
+                    &descriptorSet,
+                    0,
+                    nullptr);
+
+            uint32_t width = std::max(extent.width >> level, 1u);
+            uint32_t height = std::max(extent.height >> level, 1u);
+            vkCmdDispatch(
+                    commandBuffer,
+                    (width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+                    (height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+                    1);
+            computeBarrier(commandBuffer);
+        }
+
+        viewProjection = depthViewProjection;
+        built = true;
+    }
+
+    VkDescriptorImageInfo DepthPyramid::getImageInfo() const {
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.sampler = sampler;
+        imageInfo.imageView = imageView;
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        return imageInfo;
+    }
+
+}  // namespace Ocean
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "vulkan/descriptors.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/pipeline.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <memory>
+#include <vector>
+
+namespace Ocean {
+
+    // Mip chain holding the farthest depth under each texel, for hierarchical-Z occlusion culling.
+    // Level 0 is the largest power of two extent that fits in the depth attachment, each level
+    // halves the one above it. A box whose nearest depth is behind every texel under its screen
+    // rectangle is hidden. The image stays in VK_IMAGE_LAYOUT_GENERAL and is rebuilt on the GPU
+    // from the depth attachment.
+    class DepthPyramid {
+    public:
+        explicit DepthPyramid(Device &device);
+
+        ~DepthPyramid();
+
+        DepthPyramid(const DepthPyramid &) = delete;
+
+        DepthPyramid &operator=(const DepthPyramid &) = delete;
+
+        // recreates the image when the depth extent changed, the old one is destroyed once frames
+        // using it have retired
+        void resize(VkExtent2D depthExtent);
+
+        // records the reduction of depthImageView, which has to be in
+        // VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, into every level. Compute shader writes
+        // recorded before are visible to compute shaders recorded after, the pyramid included
+        void build(
+                VkCommandBuffer commandBuffer,
+                VkImageView depthImageView,
+                const glm::mat4 &depthViewProjection,
+                DescriptorSetCache &descriptorCache);
+
+        // every level with a nearest sampler, in VK_IMAGE_LAYOUT_GENERAL
+        [[nodiscard]] VkDescriptorImageInfo getImageInfo() const;
+
+        // false until the first build after a resize
+        [[nodiscard]] bool isBuilt() const { return built; }
+
+        // view projection the depth of the last build was rendered with
+        [[nodiscard]] const glm::mat4 &getViewProjection() const { return viewProjection; }
+
+        [[nodiscard]] uint32_t getLevelCount() const { return levelCount; }
+
+    private:
+        void createPipeline();
+
+        void createSampler();
+
+        void createImage();
+
+        // defers the destruction of the image and its views
+        void destroyImage();
+
+        Device &device;
+        std::unique_ptr<DescriptorSetLayout> setLayout;
+        VkPipelineLayout pipelineLayout{};
+        std::unique_ptr<ComputePipeline> pipeline;
+        VkSampler sampler{};
+
+        VkExtent2D depthExtent{};
+        VkExtent2D extent{};  // of level 0
+        uint32_t levelCount = 0;
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+        VkImageView imageView = VK_NULL_HANDLE;  // every level
+        std::vector<VkImageView> levelViews;  // one level each, written by the reduction
+
+        glm::mat4 viewProjection{1.f};
+        bool built = false;
+    };
+
+}  // namespace Ocean
@@ -0,0 +1,254 @@
+#include "dynamic_bvh.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+
+namespace Ocean {
+
+    DynamicBvh::DynamicBvh(float fatMargin) : fatMargin{fatMargin} {}
+
+    uint32_t DynamicBvh::allocateNode() {
+        if (freeList == INVALID_NODE) {
+            nodes.emplace_back();
+            return static_cast<uint32_t>(nodes.size() - 1);
+        }
+        uint32_t nodeId = freeList;
+        freeList = nodes[nodeId].parent;
+        nodes[nodeId] = Node{};
+        return nodeId;
+    }
+
+    void DynamicBvh::freeNode(uint32_t nodeId) {
+        nodes[nodeId].parent = freeList;
+        nodes[nodeId].height = -1;
+        freeList = nodeId;
+    }
+
+    uint32_t DynamicBvh::createProxy(const AABB &bounds, uint32_t userData) {
+        uint32_t proxyId = allocateNode();
+        Node &node = nodes[proxyId];
+        node.bounds = AABB{bounds.min - glm::vec3{fatMargin}, bounds.max + glm::vec3{fatMargin}};
+        node.userData = userData;
+        node.height = 0;
+        insertLeaf(proxyId);
+        proxyCount++;
+        return proxyId;
+    }
+
+    void DynamicBvh::destroyProxy(uint32_t proxyId) {
+        assert(proxyId < nodes.size() && nodes[proxyId].isLeaf() && "Invalid proxy id");
+        removeLeaf(proxyId);
+        freeNode(proxyId);
+        proxyCount--;
+    }
+
+    bool DynamicBvh::moveProxy(uint32_t proxyId, const AABB &bounds) {
+        assert(proxyId < nodes.size() && nodes[proxyId].isLeaf() && "Invalid proxy id");
+        if (nodes[proxyId].bounds.contains(bounds)) return false;
+
+        removeLeaf(proxyId);
+        nodes[proxyId].bounds = AABB{bounds.min - glm::vec3{fatMargin}, bounds.max + glm::vec3{fatMargin}};
+        insertLeaf(proxyId);
+        return true;
+    }
+
+    void DynamicBvh::insertLeaf(uint32_t leaf) {
+        if (root == INVALID_NODE) {
+            root = leaf;
+            nodes[root].parent = INVALID_NODE;
+            return;
+        }
+
+        // descend towards the sibling that adds the least surface area to the tree
+        const AABB leafBounds = nodes[leaf].bounds;
+        uint32_t index = root;
+        while (!nodes[index].isLeaf()) {
+            const Node &node = nodes[index];
+            float area = node.bounds.surfaceArea();
+            float combinedArea = AABB::merge(node.bounds, leafBounds).surfaceArea();
+
+            // cost of making a new parent for this node and the new leaf
+            float cost = 2.f * combinedArea;
+            // minimum cost of pushing the leaf further down the tree
+            float inheritanceCost = 2.f * (combinedArea - area);
+
+            auto descendCost = [&](uint32_t child) {
+                const AABB &childBounds = nodes[child].bounds;
+                float merged = AABB::merge(childBounds, leafBounds).surfaceArea();
+                if (nodes[child].isLeaf()) return merged + inheritanceCost;
+                return merged - childBounds.surfaceArea() + inheritanceCost;
+            };
+            float cost1 = descendCost(node.child1);
+            float cost2 = descendCost(node.child2);
+
+            if (cost < cost1 && cost < cost2) break;
+            index = cost1 < cost2 ? node.child1 : node.child2;
+        }
+        uint32_t sibling = index;
+
+        // new parent takes the sibling's place
+        uint32_t oldParent = nodes[sibling].parent;
+        uint32_t newParent = allocateNode();
+        nodes[newParent].parent = oldParent;
+        nodes[newParent].bounds = AABB::merge(leafBounds, nodes[sibling].bounds);
+        nodes[newParent].height = nodes[sibling].height + 1;
+        nodes[newParent].child1 = sibling;
+        nodes[newParent].child2 = leaf;
+        nodes[sibling].parent = newParent;
+        nodes[leaf].parent = newParent;
+
+        if (oldParent == INVALID_NODE) {
+            root = newParent;
+        } else if (nodes[oldParent].child1 == sibling) {
+            nodes[oldParent].child1 = newParent;
+        } else {
+            nodes[oldParent].child2 = newParent;
+        }
+
+        refitAncestors(nodes[leaf].parent);
+    }
+
+    void DynamicBvh::removeLeaf(uint32_t leaf) {
+        if (leaf == root) {
+            root = INVALID_NODE;
+            return;
+        }
+
+        uint32_t parent = nodes[leaf].parent;
+        uint32_t grandParent = nodes[parent].parent;
+        uint32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+        // the sibling replaces the parent
+        nodes[sibling].parent = grandParent;
+        freeNode(parent);
+        if (grandParent == INVALID_NODE) {
+            root = sibling;
+            return;
+        }
+        if (nodes[grandParent].child1 == parent) {
+            nodes[grandParent].child1 = sibling;
+        } else {
+            nodes[grandParent].child2 = sibling;
+        }
+        refitAncestors(grandParent);
+    }
+
+    void DynamicBvh::refitAncestors(uint32_t nodeId) {
+        while (nodeId != INVALID_NODE) {
+            nodeId = balance(nodeId);
+
+            Node &node = nodes[nodeId];
+            const Node &child1 = nodes[node.child1];
+            const Node &child2 = nodes[node.child2];
+            node.height = 1 + std::max(child1.height, child2.height);
+            node.bounds = AABB::merge(child1.bounds, child2.bounds);
+
+            nodeId = node.parent;
+        }
+    }
+
+    /*
+     * If a subtree is unbalanced rotate its taller child up. Returns the node now at the root of
+     * the subtree.
+     *
+     *       A
+     *     /   \
+     *    B     C
+     *   / \   / \
+     *  D   E F   G
+     */
+    uint32_t DynamicBvh::balance(uint32_t iA) {
+        Node &A = nodes[iA];
+        if (A.isLeaf() || A.height < 2) return iA;
+
+        uint32_t iB = A.child1;
+        uint32_t iC = A.child2;
+        Node &B = nodes[iB];
+        Node &C = nodes[iC];
+        int heightDifference = C.height - B.height;
+
+        // rotate C up
+        if (heightDifference > 1) {
+            uint32_t iF = C.child1;
+            uint32_t iG = C.child2;
+            Node &F = nodes[iF];
+            Node &G = nodes[iG];
+
+            // swap A and C
+            C.child1 = iA;
+            C.parent = A.parent;
+            A.parent = iC;
+            if (C.parent == INVALID_NODE) {
+                root = iC;
+            } else if (nodes[C.parent].child1 == iA) {
+                nodes[C.parent].child1 = iC;
+            } else {
+                nodes[C.parent].child2 = iC;
+            }
+
+            // keep the taller grandchild under C
+            if (F.height > G.height) {
+                C.child2 = iF;
+                A.child2 = iG;
+                G.parent = iA;
+                A.bounds = AABB::merge(B.bounds, G.bounds);
+                C.bounds = AABB::merge(A.bounds, F.bounds);
+                A.height = 1 + std::max(B.height, G.height);
+                C.height = 1 + std::max(A.height, F.height);
+            } else {
+                C.child2 = iG;
+                A.child2 = iF;
+                F.parent = iA;
+                A.bounds = AABB::merge(B.bounds, F.bounds);
+                C.bounds = AABB::merge(A.bounds, G.bounds);
+                A.height = 1 + std::max(B.height, F.height);
+                C.height = 1 + std::max(A.height, G.height);
+            }
+            return iC;
+        }
+
+        // rotate B up
+        if (heightDifference < -1) {
+            uint32_t iD = B.child1;
+            uint32_t iE = B.child2;
+            Node &D = nodes[iD];
+            Node &E = nodes[iE];
+
+            // swap A and B
+            B.child1 = iA;
+            B.parent = A.parent;
+            A.parent = iB;
+            if (B.parent == INVALID_NODE) {
+                root = iB;
+            } else if (nodes[B.parent].child1 == iA) {
+                nodes[B.parent].child1 = iB;
+            } else {
+                nodes[B.parent].child2 = iB;
+            }
+
+            // keep the taller grandchild under B
+            if (D.height > E.height) {
+                B.child2 = iD;
+                A.child1 = iE;
+                E.parent = iA;
+                A.bounds = AABB::merge(C.bounds, E.bounds);
+                B.bounds = AABB::merge(A.bounds, D.bounds);
+                A.height = 1 + std::max(C.height, E.height);
+                B.height = 1 + std::max(A.height, D.height);
+            } else {
+                B.child2 = iE;
+                A.child1 = iD;
+                D.parent = iA;
+                A.bounds = AABB::merge(C.bounds, D.bounds);
+                B.bounds = AABB::merge(A.bounds, E.bounds);
+                A.height = 1 + std::max(C.height, D.height);
+                B.height = 1 + std::max(A.height, E.height);
+            }
+            return iB;
+        }
+
+        return iA;
+    }
+
+}  // namespace Ocean
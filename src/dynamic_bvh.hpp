@@ -0,0 +1,156 @@
+#pragma once
+
+#include "geometry.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace Ocean {
+
+    // Incrementally updated bounding volume hierarchy, based on the dynamic AABB tree used in
+    // Box2D. Leaves store a fattened box so objects moving a little don't touch the tree, and
+    // insertions pick the sibling with the lowest surface area cost and rebalance with rotations.
+    class DynamicBvh {
+    public:
+        static constexpr uint32_t INVALID_NODE = ~0u;
+
+        explicit DynamicBvh(float fatMargin = 0.1f);
+
+        DynamicBvh(const DynamicBvh &) = delete;
+
+        DynamicBvh &operator=(const DynamicBvh &) = delete;
+
+        // returns the proxy id used to move or destroy the leaf
+        uint32_t createProxy(const AABB &bounds, uint32_t userData);
+
+        void destroyProxy(uint32_t proxyId);
+
+        // returns true if the leaf had to be reinserted
+        bool moveProxy(uint32_t proxyId, const AABB &bounds);
+
+        [[nodiscard]] uint32_t getUserData(uint32_t proxyId) const { return nodes[proxyId].userData; }
+
+        [[nodiscard]] const AABB &getFatBounds(uint32_t proxyId) const { return nodes[proxyId].bounds; }
+
+        [[nodiscard]] uint32_t getProxyCount() const { return proxyCount; }
+
+        [[nodiscard]] int getHeight() const { return root == INVALID_NODE ? 0 : nodes[root].height; }
+
+        // visitor is called with the user data of every leaf whose fat bounds pass the test,
+        // callers wanting exact results re-test against the object's own bounds
+        template<typename Fn>
+        void query(const AABB &box, Fn &&visitor) const {
+            traverse([&](const AABB &bounds) { return bounds.intersects(box); }, visitor);
+        }
+
+        template<typename Fn>
+        void query(const Sphere &sphere, Fn &&visitor) const {
+            traverse([&](const AABB &bounds) { return sphere.intersects(bounds); }, visitor);
+        }
+
+        template<typename Fn>
+        void query(const Frustum &frustum, Fn &&visitor) const {
+            traverse([&](const AABB &bounds) { return frustum.intersects(bounds); }, visitor);
+        }
+
+        // visitor(userData, distance) is called for leaves the ray enters within maxDistance and
+        // returns the new maxDistance, return distance to keep only closer hits or 0 to stop
+        template<typename Fn>
+        void raycast(const Ray &ray, float maxDistance, Fn &&visitor) const {
+            if (root == INVALID_NODE) return;
+            TraversalStack stack{};
+            stack.push(root);
+            while (!stack.empty() && maxDistance > 0.f) {
+                const Node &node = nodes[stack.pop()];
+                float distance = ray.intersect(node.bounds, maxDistance);
+                if (distance < 0.f) continue;
+                if (node.isLeaf()) {
+                    maxDistance = visitor(node.userData, distance);
+                } else {
+                    stack.push(node.child1);
+                    stack.push(node.child2);
+                }
+            }
+        }
+
+    private:
+        struct Node {
+            AABB bounds;
+            uint32_t parent = INVALID_NODE;  // next free node while on the free list
+            uint32_t child1 = INVALID_NODE;
+            uint32_t child2 = INVALID_NODE;
+            int height = -1;  // 0 for leaves, -1 for free nodes
+            uint32_t userData = 0;
+
+            [[nodiscard]] bool isLeaf() const { return child1 == INVALID_NODE; }
+        };
+
+        template<typename Test, typename Fn>
+        void traverse(Test &&test, Fn &&visitor) const {
+            if (root == INVALID_NODE) return;
+            TraversalStack stack{};
+            stack.push(root);
+            while (!stack.empty()) {
+                const Node &node = nodes[stack.pop()];
+                if (!test(node.bounds)) continue;
+                if (node.isLeaf()) {
+                    visitor(node.userData);
+                } else {
+                    stack.push(node.child1);
+                    stack.push(node.child2);
+                }
+            }
+        }
+
+        // lives on the call stack so queries are reentrant. Rotations keep the tree AVL balanced,
+        // its height stays below 1.44 * log2(leaves) so the inline entries normally suffice and
+        // queries never allocate. A deeper tree spills into overflow instead of writing past them
+        struct TraversalStack {
+            static constexpr uint32_t INLINE_CAPACITY = 128;
+
+            uint32_t entries[INLINE_CAPACITY];
+            uint32_t count = 0;
+            std::vector<uint32_t> overflow;  // the top of the stack once entries is full
+
+            void push(uint32_t nodeId) {
+                if (count < INLINE_CAPACITY) {
+                    entries[count++] = nodeId;
+                } else {
+                    overflow.push_back(nodeId);
+                }
+            }
+
+            uint32_t pop() {
+                if (!overflow.empty()) {
+                    uint32_t nodeId = overflow.back();
+                    overflow.pop_back();
+                    return nodeId;
+                }
+                return entries[--count];
+            }
+
+            [[nodiscard]] bool empty() const { return count == 0; }
+        };
+
+        uint32_t allocateNode();
+
+        void freeNode(uint32_t nodeId);
+
+        void insertLeaf(uint32_t leaf);
+
+        void removeLeaf(uint32_t leaf);
+
+        // walks from nodeId to the root restoring heights and bounds
+        void refitAncestors(uint32_t nodeId);
+
+        uint32_t balance(uint32_t nodeId);
+
+        float fatMargin;
+        std::vector<Node> nodes;
+        uint32_t root = INVALID_NODE;
+        uint32_t freeList = INVALID_NODE;
+        uint32_t proxyCount = 0;
+    };
+
+}  // namespace Ocean
@@ -2,6 +2,8 @@
 
 #include "camera.hpp"
 #include "game_object.hpp"
+#include "job_system.hpp"
+#include "renderer.hpp"
 #include "vulkan/descriptors.hpp"
 
 // lib
@@ -9,11 +11,11 @@
 
 namespace Ocean {
 
-#define MAX_LIGHTS 10
-
+    // element of the light storage buffer, see LightClusterGrid
     struct PointLight {
-        glm::vec4 position{};  // ignore w
+        glm::vec4 position{};  // w is range
         glm::vec4 color{};     // w is intensity
+        glm::ivec4 shadow{-1, 0, 0, 0};  // x is the light's ShadowSystem shadow map or -1, yzw unused
     };
 
     struct GlobalUbo {
@@ -21,8 +23,17 @@ namespace Ocean {
         glm::mat4 view{1.f};
         glm::mat4 inverseView{1.f};
         glm::vec4 ambientLightColor{1.f, 1.f, 1.f, .02f};  // w is intensity
-        PointLight pointLights[MAX_LIGHTS];
-        int numLights;
+        // maps fragments to light clusters: xy clusters per pixel, z and w scale and bias of the
+        // log view depth giving the depth slice
+        glm::vec4 clusterScale{};
+        glm::uvec4 clusterCounts{};  // clusters per axis, w is the number of lights
+    };
+
+    // Forward shades every fragment while drawing it, Deferred draws a G-buffer first and shades
+    // each pixel once in a lighting subpass, see SwapChain::getDeferredRenderPass
+    enum class ShadingPath {
+        Forward,
+        Deferred
     };
 
     struct FrameInfo {
@@ -31,7 +42,11 @@ namespace Ocean {
         VkCommandBuffer commandBuffer;
         Camera &camera;
         VkDescriptorSet globalDescriptorSet;
-        DescriptorPool &frameDescriptorPool;  // pool of descriptors that is cleared each frame
-        GameObject::Map &gameObjects;
+        DescriptorSetCache &descriptorCache;  // sets kept across frames, keyed by their contents
+        GameObjectManager &gameObjectManager;
+        JobSystem &jobSystem;
+        OceanRenderer &renderer;  // hands out secondary command buffers inside the render pass
+        VkDescriptorSet lightDescriptorSet = VK_NULL_HANDLE;  // light clusters, set once they are built
+        ShadingPath shadingPath = ShadingPath::Forward;
     };
 }  // namespace Ocean
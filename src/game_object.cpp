@@ -1,119 +1,639 @@
 #include "game_object.hpp"
 
-#include <numeric>
+#include "render_queue.hpp"
+
+// std
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
 
 namespace Ocean {
 
-    glm::mat4 TransformComponent::mat4() const {
-        const float c3 = glm::cos(rotation.z);
-        const float s3 = glm::sin(rotation.z);
-        const float c2 = glm::cos(rotation.x);
-        const float s2 = glm::sin(rotation.x);
-        const float c1 = glm::cos(rotation.y);
-        const float s1 = glm::sin(rotation.y);
-        return glm::mat4{
-                {
-                        scale.x * (c1 * c3 + s1 * s2 * s3),
-                        scale.x * (c2 * s3),
-                        scale.x * (c1 * s2 * s3 - c3 * s1),
-                        0.0f,
-                },
-                {
-                        scale.y * (c3 * s1 * s2 - c1 * s3),
-                        scale.y * (c2 * c3),
-                        scale.y * (c1 * c3 * s2 + s1 * s3),
-                        0.0f,
-                },
-                {
-                        scale.z * (c2 * s1),
-                        scale.z * (-s2),
-                        scale.z * (c1 * c2),
-                        0.0f,
-                },
-                {
-                        translation.x,
-                        translation.y,
-                        translation.z,
-                        1.0f
-                }
-        };
+    GameObject::id_t GameObjectManager::allocateId(uint32_t index) {
+        uint32_t slot;
+        if (freeSlots.empty()) {
+            slot = static_cast<uint32_t>(slotGenerations.size());
+            assert(slot < GameObject::MAX_SLOTS && "Max game object count exceeded!");
+            slotGenerations.push_back(0);
+        } else {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        objectIndex.insert(slot, index);
+        return GameObject::makeId(slot, slotGenerations[slot]);
     }
 
-    glm::mat3 TransformComponent::normalMatrix() const {
-        const float c3 = glm::cos(rotation.z);
-        const float s3 = glm::sin(rotation.z);
-        const float c2 = glm::cos(rotation.x);
-        const float s2 = glm::sin(rotation.x);
-        const float c1 = glm::cos(rotation.y);
-        const float s1 = glm::sin(rotation.y);
-        const glm::vec3 invScale = 1.0f / scale;
-
-        return glm::mat3{
-                {
-                        invScale.x * (c1 * c3 + s1 * s2 * s3),
-                        invScale.x * (c2 * s3),
-                        invScale.x * (c1 * s2 * s3 - c3 * s1),
-                },
-                {
-                        invScale.y * (c3 * s1 * s2 - c1 * s3),
-                        invScale.y * (c2 * c3),
-                        invScale.y * (c1 * c3 * s2 + s1 * s3),
-                },
-                {
-                        invScale.z * (c2 * s1),
-                        invScale.z * (-s2),
-                        invScale.z * (c1 * c2),
-                },
-        };
+    GameObject GameObjectManager::createGameObject() {
+        uint32_t index = objects.size();
+        GameObject::id_t id = allocateId(index);
+
+        objects.ids.push_back(id);
+        objects.translations.emplace_back(0.f);
+        objects.rotations.emplace_back(0.f);
+        objects.scales.emplace_back(1.f);
+        objects.colors.emplace_back(0.f);
+        objects.models.push_back(INVALID_HANDLE);
+        objects.textures.push_back(textureDefault);
+        objects.pointLights.push_back(INVALID_HANDLE);
+        objects.parentIds.push_back(INVALID_HANDLE);
+        objects.parents.push_back(INVALID_HANDLE);
+        objects.subtreeSizes.push_back(1);
+        objects.localData.emplace_back();
+        objects.bufferData.emplace_back();
+        objects.worldBounds.emplace_back();
+        objects.sphereCentersX.push_back(0.f);
+        objects.sphereCentersY.push_back(0.f);
+        objects.sphereCentersZ.push_back(0.f);
+        objects.sphereRadii.push_back(-std::numeric_limits<float>::infinity());
+        objects.bvhProxies.push_back(DynamicBvh::INVALID_NODE);
+        objects.dirtyFrames.push_back(0);
+        objects.movedAt.push_back(updateCount);
+        markTransformDirty(index);
+        return GameObject{id, *this};
     }
 
-    GameObject &GameObjectManager::makePointLight(
+    GameObject GameObjectManager::makePointLight(
             float intensity, float radius, glm::vec3 color) {
-        auto &gameObj = createGameObject();
-        gameObj.color = color;
-        gameObj.transform.scale.x = radius;
-        gameObj.pointLight = std::make_unique<PointLightComponent>();
-        gameObj.pointLight->lightIntensity = intensity;
+        auto gameObj = createGameObject();
+        gameObj.color() = color;
+        gameObj.scale().x = radius;
+
+        uint32_t objIndex = indexOf(gameObj.getId());
+        objects.pointLights[objIndex] = pointLights.size();
+        pointLights.objectIndices.push_back(objIndex);
+        pointLights.lights.push_back(PointLightComponent{intensity, PointLightComponent::defaultRange(intensity)});
         return gameObj;
     }
 
-    GameObjectManager::GameObjectManager(Device &device) {
-        // including nonCoherentAtomSize allows us to flush a specific index at once
-        int alignment = std::lcm(
-                device.properties.limits.nonCoherentAtomSize,
-                device.properties.limits.minUniformBufferOffsetAlignment);
-        for (auto &uboBuffer: uboBuffers) {
-            uboBuffer = std::make_unique<OceanBuffer>(
-                    device,
-                    sizeof(GameObjectBufferData),
-                    GameObjectManager::MAX_GAME_OBJECTS,
-                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-                    alignment);
-            uboBuffer->map();
+    std::vector<GameObject::id_t> GameObjectManager::loadScene(
+            const SceneFile &scene,
+            const std::vector<ModelHandle> &models,
+            const std::vector<TextureHandle> &textures) {
+        assert(models.size() == scene.getModelCount() && "Scene needs one model handle per model path");
+        assert(textures.size() == scene.getTextureCount() && "Scene needs one texture handle per texture path");
+        const uint32_t first = objects.size();
+        const uint32_t count = scene.getObjectCount();
+        const uint32_t total = first + count;
+        objects.forEachArray([&](auto &values) { values.reserve(total); });
+
+        std::vector<GameObject::id_t> ids(count);
+        for (uint32_t i = 0; i < count; i++) {
+            ids[i] = allocateId(first + i);
+        }
+        objects.ids.insert(objects.ids.end(), ids.begin(), ids.end());
+
+        // these sections have the storage layout, copy them straight out of the mapping
+        objects.translations.insert(
+                objects.translations.end(), scene.getTranslations(), scene.getTranslations() + count);
+        objects.rotations.insert(objects.rotations.end(), scene.getRotations(), scene.getRotations() + count);
+        objects.scales.insert(objects.scales.end(), scene.getScales(), scene.getScales() + count);
+        objects.colors.insert(objects.colors.end(), scene.getColors(), scene.getColors() + count);
+
+        const uint32_t *sceneModels = scene.getModels();
+        const uint32_t *sceneTextures = scene.getTextures();
+        const uint32_t *sceneParents = scene.getParents();
+        for (uint32_t i = 0; i < count; i++) {
+            objects.models.push_back(
+                    sceneModels[i] == SceneFile::NO_REFERENCE ? INVALID_HANDLE : models[sceneModels[i]]);
+            objects.textures.push_back(
+                    sceneTextures[i] == SceneFile::NO_REFERENCE ? textureDefault : textures[sceneTextures[i]]);
+            if (sceneParents[i] == SceneFile::NO_REFERENCE) {
+                objects.parentIds.push_back(INVALID_HANDLE);
+            } else {
+                objects.parentIds.push_back(ids[sceneParents[i]]);
+                parentedCount++;
+                hierarchyChanged = true;
+            }
+        }
+
+        objects.pointLights.resize(total, INVALID_HANDLE);
+        objects.parents.resize(total, INVALID_HANDLE);
+        objects.subtreeSizes.resize(total, 1);
+        objects.localData.resize(total);
+        objects.bufferData.resize(total);
+        objects.worldBounds.resize(total);
+        objects.sphereCentersX.resize(total, 0.f);
+        objects.sphereCentersY.resize(total, 0.f);
+        objects.sphereCentersZ.resize(total, 0.f);
+        objects.sphereRadii.resize(total, -std::numeric_limits<float>::infinity());
+        objects.bvhProxies.resize(total, DynamicBvh::INVALID_NODE);
+        objects.dirtyFrames.resize(total, 0);
+        objects.movedAt.resize(total, updateCount);
+
+        const SceneLight *sceneLights = scene.getLights();
+        for (uint32_t i = 0; i < scene.getLightCount(); i++) {
+            uint32_t objIndex = first + sceneLights[i].objectIndex;
+            objects.pointLights[objIndex] = pointLights.size();
+            pointLights.objectIndices.push_back(objIndex);
+            float intensity = sceneLights[i].intensity;
+            pointLights.lights.push_back(PointLightComponent{intensity, PointLightComponent::defaultRange(intensity)});
         }
 
-        textureDefault = Texture::createTextureFromFile(device, "../textures/star.jpg");
+        dirtyIndices.reserve(dirtyIndices.size() + count);
+        for (uint32_t i = first; i < total; i++) {
+            markTransformDirty(i);
+        }
+        return ids;
+    }
+
+    void GameObjectManager::destroyGameObject(GameObject::id_t id) {
+        if (parentedCount == 0) {
+            removeAt(indexOf(id));
+            return;
+        }
+
+        // children go with their parent, in pre-order they are the range after it
+        if (hierarchyChanged) {
+            sortHierarchy();
+        }
+        uint32_t index = indexOf(id);
+        std::vector<GameObject::id_t> subtree{
+                objects.ids.begin() + index, objects.ids.begin() + index + objects.subtreeSizes[index]};
+        // children first, so no remaining object references a destroyed parent
+        for (auto it = subtree.rbegin(); it != subtree.rend(); ++it) {
+            removeAt(indexOf(*it));
+        }
+        // swap removal breaks pre-order
+        hierarchyChanged = true;
+    }
+
+    void GameObjectManager::removeAt(uint32_t index) {
+        const uint32_t last = objects.size() - 1;
+        const GameObject::id_t id = objects.ids[index];
+
+        if (objects.parentIds[index] != INVALID_HANDLE) {
+            parentedCount--;
+        }
+        if (objects.bvhProxies[index] != DynamicBvh::INVALID_NODE) {
+            spatialIndex.destroyProxy(objects.bvhProxies[index]);
+        }
+        if (objects.pointLights[index] != INVALID_HANDLE) {
+            removePointLight(objects.pointLights[index]);
+        }
+
+        // drop the object from the dirty list and re-point the entry of the object that moves in
+        auto eraseDirty = [&](uint32_t dirtyIndex) {
+            auto it = std::find(dirtyIndices.begin(), dirtyIndices.end(), dirtyIndex);
+            *it = dirtyIndices.back();
+            dirtyIndices.pop_back();
+        };
+        if (objects.dirtyFrames[index] != 0) {
+            eraseDirty(index);
+        }
+        if (index != last) {
+            if (objects.dirtyFrames[last] != 0) {
+                *std::find(dirtyIndices.begin(), dirtyIndices.end(), last) = index;
+            }
+            objects.forEachArray([&](auto &values) { values[index] = std::move(values[last]); });
+            objectIndex.update(GameObject::slotOf(objects.ids[index]), index);
+            if (objects.pointLights[index] != INVALID_HANDLE) {
+                pointLights.objectIndices[objects.pointLights[index]] = index;
+            }
+            // the moved object now lives in another buffer slot, every frame needs a new copy
+            markFrameDirty(index, ALL_FRAMES_DIRTY);
+        }
+        objects.forEachArray([](auto &values) { values.pop_back(); });
+
+        uint32_t slot = GameObject::slotOf(id);
+        objectIndex.erase(slot);
+        slotGenerations[slot] = (slotGenerations[slot] + 1) & GameObject::GENERATION_MASK;
+        freeSlots.push_back(slot);
+    }
+
+    void GameObjectManager::removePointLight(uint32_t lightIndex) {
+        uint32_t lastLight = pointLights.size() - 1;
+        if (lightIndex != lastLight) {
+            pointLights.lights[lightIndex] = pointLights.lights[lastLight];
+            pointLights.objectIndices[lightIndex] = pointLights.objectIndices[lastLight];
+            objects.pointLights[pointLights.objectIndices[lightIndex]] = lightIndex;
+        }
+        pointLights.lights.pop_back();
+        pointLights.objectIndices.pop_back();
+    }
+
+    void GameObjectManager::setParent(GameObject::id_t child, GameObject::id_t parent) {
+        uint32_t childIndex = indexOf(child);
+        for (GameObject::id_t ancestor = parent; ancestor != INVALID_HANDLE;
+             ancestor = objects.parentIds[indexOf(ancestor)]) {
+            assert(ancestor != child && "Game object cannot be parented to its own descendant");
+        }
+        if (objects.parentIds[childIndex] == INVALID_HANDLE) {
+            parentedCount++;
+        }
+        objects.parentIds[childIndex] = parent;
+        hierarchyChanged = true;
+        markTransformDirty(childIndex);
+    }
+
+    void GameObjectManager::clearParent(GameObject::id_t child) {
+        uint32_t childIndex = indexOf(child);
+        if (objects.parentIds[childIndex] != INVALID_HANDLE) {
+            parentedCount--;
+        }
+        objects.parentIds[childIndex] = INVALID_HANDLE;
+        hierarchyChanged = true;
+        markTransformDirty(childIndex);
+    }
+
+    namespace {
+
+        template<typename T>
+        void applyOrder(std::vector<T> &values, const std::vector<uint32_t> &order) {
+            std::vector<T> sorted;
+            sorted.reserve(values.size());
+            for (uint32_t oldIndex: order) {
+                sorted.push_back(std::move(values[oldIndex]));
+            }
+            values.swap(sorted);
+        }
+
+    }  // namespace
+
+    void GameObjectManager::sortHierarchy() {
+        const uint32_t count = objects.size();
+
+        // dense parent indices are only maintained between sorts, rebuild them from the ids
+        for (uint32_t i = 0; i < count; i++) {
+            GameObject::id_t parentId = objects.parentIds[i];
+            objects.parents[i] = parentId == INVALID_HANDLE ? INVALID_HANDLE : indexOf(parentId);
+        }
+
+        // child lists as linked lists through the dense indices, built back to front so children
+        // keep their current relative order
+        std::vector<uint32_t> firstChild(count, INVALID_HANDLE);
+        std::vector<uint32_t> nextSibling(count, INVALID_HANDLE);
+        for (uint32_t i = count; i-- > 0;) {
+            uint32_t parent = objects.parents[i];
+            if (parent == INVALID_HANDLE) continue;
+            nextSibling[i] = firstChild[parent];
+            firstChild[parent] = i;
+        }
+
+        // depth first pre-order, roots in their current order
+        std::vector<uint32_t> order;
+        order.reserve(count);
+        std::vector<uint32_t> stack;
+        for (uint32_t root = 0; root < count; root++) {
+            if (objects.parents[root] != INVALID_HANDLE) continue;
+            stack.push_back(root);
+            while (!stack.empty()) {
+                uint32_t node = stack.back();
+                stack.pop_back();
+                order.push_back(node);
+
+                // push in reverse so the first child is visited first
+                size_t firstPushed = stack.size();
+                for (uint32_t child = firstChild[node]; child != INVALID_HANDLE; child = nextSibling[child]) {
+                    stack.push_back(child);
+                }
+                std::reverse(stack.begin() + static_cast<std::ptrdiff_t>(firstPushed), stack.end());
+            }
+        }
+        assert(order.size() == count && "Game object hierarchy contains a cycle");
+
+        std::vector<uint32_t> newIndexOf(count);
+        for (uint32_t newIndex = 0; newIndex < count; newIndex++) {
+            newIndexOf[order[newIndex]] = newIndex;
+        }
+
+        objects.forEachArray([&](auto &values) { applyOrder(values, order); });
+
+        for (uint32_t i = 0; i < count; i++) {
+            objectIndex.update(GameObject::slotOf(objects.ids[i]), i);
+            if (objects.parents[i] != INVALID_HANDLE) {
+                objects.parents[i] = newIndexOf[objects.parents[i]];
+            }
+        }
+        for (auto &objIndex: pointLights.objectIndices) {
+            objIndex = newIndexOf[objIndex];
+        }
+        for (auto &index: dirtyIndices) {
+            index = newIndexOf[index];
+        }
+
+        // parents come before children, so accumulating back to front sees every child first
+        std::fill(objects.subtreeSizes.begin(), objects.subtreeSizes.end(), 1u);
+        for (uint32_t i = count; i-- > 0;) {
+            if (objects.parents[i] != INVALID_HANDLE) {
+                objects.subtreeSizes[objects.parents[i]] += objects.subtreeSizes[i];
+            }
+        }
+
+        // buffer slots follow the dense index, objects that moved need every frame's copy rewritten
+        for (uint32_t i = 0; i < count; i++) {
+            if (order[i] != i) {
+                markFrameDirty(i, ALL_FRAMES_DIRTY);
+            }
+        }
+        hierarchyChanged = false;
+    }
+
+    void GameObjectManager::updateWorldRange(uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; i++) {
+            const auto &local = objects.localData[i];
+            auto &world = objects.bufferData[i];
+            uint32_t parent = objects.parents[i];
+            if (parent == INVALID_HANDLE) {
+                world = local;
+                continue;
+            }
+            // normal matrices compose the same way, both are inverse transposes of their model matrix
+            const auto &parentWorld = objects.bufferData[parent];
+            world.modelMatrix = parentWorld.modelMatrix * local.modelMatrix;
+            world.normalMatrix = parentWorld.normalMatrix * local.normalMatrix;
+        }
+    }
+
+    void GameObjectManager::updateWorldSubtree(uint32_t root) {
+        uint32_t end = root + objects.subtreeSizes[root];
+        if (end - root < PARALLEL_SUBTREE_SIZE) {
+            updateWorldRange(root, end);
+            return;
+        }
+
+        updateWorldRange(root, root + 1);
+        uint32_t firstChild = root + 1;
+        if (firstChild + objects.subtreeSizes[firstChild] == end) {
+            // a single child, look for siblings further down
+            updateWorldSubtree(firstChild);
+            return;
+        }
+
+        // sibling subtrees only read their own ancestors, split them into contiguous chunks of
+        // roughly equal size and update the chunks concurrently
+        uint32_t threads = jobSystem.getThreadCount();
+        uint32_t chunkSize = (end - firstChild + threads - 1) / threads;
+        std::vector<uint32_t> chunkStarts{firstChild};
+        for (uint32_t child = firstChild; child < end; child += objects.subtreeSizes[child]) {
+            uint32_t childEnd = child + objects.subtreeSizes[child];
+            if (childEnd - chunkStarts.back() >= chunkSize || childEnd == end) {
+                chunkStarts.push_back(childEnd);
+            }
+        }
+        auto chunkCount = static_cast<uint32_t>(chunkStarts.size() - 1);
+        jobSystem.parallelFor(0, chunkCount, 1, [&](uint32_t first, uint32_t last) {
+            for (uint32_t chunk = first; chunk < last; chunk++) {
+                updateWorldRange(chunkStarts[chunk], chunkStarts[chunk + 1]);
+            }
+        });
+    }
+
+    void GameObjectManager::updateBounds(uint32_t index) {
+        const auto &world = objects.bufferData[index].modelMatrix;
+        AABB bounds{};
+        if (Model *model = getModel(objects.models[index])) {
+            bounds = model->getBounds().transformed(world);
+        } else if (objects.pointLights[index] != INVALID_HANDLE) {
+            // light billboards face the camera, bound them by a sphere of their world radius
+            glm::vec3 radius{worldScale(index)};
+            glm::vec3 center{world[3]};
+            bounds = AABB{center - radius, center + radius};
+        }
+        objects.worldBounds[index] = bounds;
+        glm::vec3 sphereCenter = bounds.isEmpty() ? glm::vec3{0.f} : bounds.center();
+        objects.sphereCentersX[index] = sphereCenter.x;
+        objects.sphereCentersY[index] = sphereCenter.y;
+        objects.sphereCentersZ[index] = sphereCenter.z;
+        objects.sphereRadii[index] =
+                bounds.isEmpty() ? -std::numeric_limits<float>::infinity() : glm::length(bounds.extent());
+
+        uint32_t &proxy = objects.bvhProxies[index];
+        if (bounds.isEmpty()) {
+            if (proxy != DynamicBvh::INVALID_NODE) {
+                spatialIndex.destroyProxy(proxy);
+                proxy = DynamicBvh::INVALID_NODE;
+            }
+        } else if (proxy == DynamicBvh::INVALID_NODE) {
+            proxy = spatialIndex.createProxy(bounds, objects.ids[index]);
+        } else {
+            spatialIndex.moveProxy(proxy, bounds);
+        }
+    }
+
+    ModelHandle GameObjectManager::registerModel(const std::shared_ptr<Model> &model) {
+        if (model == nullptr) return INVALID_HANDLE;
+        auto it = modelHandles.find(model.get());
+        if (it != modelHandles.end()) return it->second;
+
+        auto handle = static_cast<ModelHandle>(modelAssets.size());
+        // draws are sorted by RenderQueue keys that hold the handle as their mesh
+        if (handle >= (1u << RenderQueue::MESH_BITS)) {
+            throw std::runtime_error("too many models for the render queue sort key!");
+        }
+        [[maybe_unused]] uint32_t meshIndex = meshPool.add(*model);
+        assert(meshIndex == handle && "Mesh pool out of sync with model handles");
+        // the pool holds the only GPU copy of the geometry
+        model->releaseBuffers();
+        modelAssets.push_back(model);
+        modelHandles.emplace(model.get(), handle);
+        return handle;
+    }
+
+    TextureHandle GameObjectManager::registerTexture(const std::shared_ptr<Texture> &texture) {
+        if (texture == nullptr) return INVALID_HANDLE;
+        auto it = textureHandles.find(texture.get());
+        if (it != textureHandles.end()) return it->second;
+
+        auto handle = static_cast<TextureHandle>(textureAssets.size());
+        // draws are sorted by RenderQueue keys that hold the handle as their material
+        if (handle >= (1u << RenderQueue::MATERIAL_BITS)) {
+            throw std::runtime_error("too many textures for the render queue sort key!");
+        }
+        [[maybe_unused]] uint32_t tableIndex = textureTable.add(*texture);
+        assert(tableIndex == handle && "Texture table out of sync with texture handles");
+        textureAssets.push_back(texture);
+        textureHandles.emplace(texture.get(), handle);
+        return handle;
+    }
+
+    GameObjectManager::GameObjectManager(Device &device, JobSystem &jobSystem)
+            : device{device}, jobSystem{jobSystem}, meshPool{device}, textureTable{device} {
+        for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+            objectBuffers[i] = createObjectBuffer(sizeof(GameObjectBufferData), INITIAL_OBJECT_CAPACITY);
+            boundsBuffers[i] = createObjectBuffer(sizeof(GameObjectBounds), INITIAL_OBJECT_CAPACITY);
+        }
+
+        textureDefault = registerTexture(Texture::createTextureFromFile(device, "../textures/star.jpg"));
+    }
+
+    std::unique_ptr<OceanBuffer> GameObjectManager::createObjectBuffer(
+            VkDeviceSize elementSize, uint32_t capacity) const {
+        auto objectBuffer = std::make_unique<OceanBuffer>(
+                device,
+                elementSize,
+                capacity,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        objectBuffer->map();
+        return objectBuffer;
+    }
+
+    void GameObjectManager::reserveObjectBuffer(int frameIndex, uint32_t objectCount) {
+        uint32_t capacity = objectBuffers[frameIndex]->getInstanceCount();
+        if (objectCount <= capacity) return;
+
+        while (capacity < objectCount) {
+            capacity *= 2;
+        }
+        // each frame in flight owns its buffer, so only this frame's copy is replaced. The old
+        // buffer may still be read by a submitted frame, its destructor defers the actual free
+        // until that frame has retired
+        objectBuffers[frameIndex] = createObjectBuffer(sizeof(GameObjectBufferData), capacity);
+        boundsBuffers[frameIndex] = createObjectBuffer(sizeof(GameObjectBounds), capacity);
+
+        // the new buffer starts empty, every object has to be written to it again
+        for (uint32_t i = 0; i < objects.size(); i++) {
+            markFrameDirty(i, static_cast<uint8_t>(1u << frameIndex));
+        }
+    }
+
+    void GameObjectManager::markTransformDirty(uint32_t index) {
+        markFrameDirty(index, ALL_FRAMES_DIRTY | TRANSFORM_STALE);
+    }
+
+    void GameObjectManager::markFrameDirty(uint32_t index, uint8_t frameBits) {
+        uint8_t &dirty = objects.dirtyFrames[index];
+        if (dirty == 0) {
+            dirtyIndices.push_back(index);
+        }
+        dirty |= frameBits;
     }
 
     void GameObjectManager::updateBuffer(int frameIndex) {
-        // copy model matrix and normal matrix for each gameObj into
-        // buffer for this frame
-        for (auto &kv: gameObjects) {
-            auto &obj = kv.second;
-            GameObjectBufferData data{};
-            data.modelMatrix = obj.transform.mat4();
-            data.normalMatrix = obj.transform.normalMatrix();
-            uboBuffers[frameIndex]->writeToIndex(&data, kv.first);
+        updateCount++;
+        if (hierarchyChanged) {
+            sortHierarchy();
         }
-        uboBuffers[frameIndex]->flush();
+        reserveObjectBuffer(frameIndex, objects.size());
+
+        // recompute local matrices of every changed transform in one batch
+        staleIndices.clear();
+        for (uint32_t index: dirtyIndices) {
+            uint8_t &dirty = objects.dirtyFrames[index];
+            if (dirty & TRANSFORM_STALE) {
+                staleIndices.push_back(index);
+                dirty &= ~TRANSFORM_STALE;
+            }
+        }
+        jobSystem.parallelFor(
+                0, static_cast<uint32_t>(staleIndices.size()), TRANSFORM_BATCH_SIZE,
+                [this](uint32_t first, uint32_t last) {
+                    computeTransforms(
+                            objects.translations.data(),
+                            objects.rotations.data(),
+                            objects.scales.data(),
+                            staleIndices.data() + first,
+                            last - first,
+                            objects.localData.data());
+                });
+
+        // then world matrices of each changed subtree, in pre-order a subtree is one linear range
+        // and subtrees nested in one already visited are skipped
+        std::sort(staleIndices.begin(), staleIndices.end());
+        uint32_t visitedEnd = 0;
+        for (uint32_t index: staleIndices) {
+            if (index < visitedEnd) continue;
+            updateWorldSubtree(index);
+            visitedEnd = index + objects.subtreeSizes[index];
+            for (uint32_t i = index; i < visitedEnd; i++) {
+                markFrameDirty(i, ALL_FRAMES_DIRTY);
+                updateBounds(i);
+                objects.movedAt[i] = updateCount;
+            }
+        }
+
+        auto frameBit = static_cast<uint8_t>(1u << frameIndex);
+        auto &objectBuffer = *objectBuffers[frameIndex];
+        auto &boundsBuffer = *boundsBuffers[frameIndex];
+        writtenIndices.clear();
+
+        // copy model matrix, normal matrix and world bounds of each changed gameObj into the
+        // buffers for this frame, objects stay in the dirty list until every frame in flight has
+        // a copy
+        size_t remaining = 0;
+        for (uint32_t index: dirtyIndices) {
+            uint8_t &dirty = objects.dirtyFrames[index];
+            if (dirty & frameBit) {
+                const AABB &worldBounds = objects.worldBounds[index];
+                GameObjectBounds bounds{glm::vec4{worldBounds.min, 0.f}, glm::vec4{worldBounds.max, 0.f}};
+                objectBuffer.writeToIndex(&objects.bufferData[index], static_cast<int>(index));
+                boundsBuffer.writeToIndex(&bounds, static_cast<int>(index));
+                writtenIndices.push_back(index);
+                dirty &= ~frameBit;
+            }
+            if (dirty != 0) {
+                dirtyIndices[remaining++] = index;
+            }
+        }
+        dirtyIndices.resize(remaining);
+
+        std::sort(writtenIndices.begin(), writtenIndices.end());
+        objectBuffer.flushIndices(writtenIndices);
+        boundsBuffer.flushIndices(writtenIndices);
+    }
+
+    glm::vec3 &GameObject::translation() {
+        uint32_t index = gameObjectManager->indexOf(id);
+        gameObjectManager->markTransformDirty(index);
+        return gameObjectManager->objects.translations[index];
+    }
+
+    glm::vec3 &GameObject::rotation() {
+        uint32_t index = gameObjectManager->indexOf(id);
+        gameObjectManager->markTransformDirty(index);
+        return gameObjectManager->objects.rotations[index];
+    }
+
+    glm::vec3 &GameObject::scale() {
+        uint32_t index = gameObjectManager->indexOf(id);
+        gameObjectManager->markTransformDirty(index);
+        return gameObjectManager->objects.scales[index];
+    }
+
+    TransformComponent GameObject::transform() const {
+        const auto &objects = gameObjectManager->objects;
+        uint32_t index = gameObjectManager->indexOf(id);
+        return TransformComponent{objects.translations[index], objects.scales[index], objects.rotations[index]};
+    }
+
+    glm::vec3 &GameObject::color() {
+        return gameObjectManager->objects.colors[gameObjectManager->indexOf(id)];
+    }
+
+    Model *GameObject::model() const {
+        return gameObjectManager->getModel(gameObjectManager->objects.models[gameObjectManager->indexOf(id)]);
+    }
+
+    void GameObject::setModel(const std::shared_ptr<Model> &model) {
+        uint32_t index = gameObjectManager->indexOf(id);
+        gameObjectManager->objects.models[index] = gameObjectManager->registerModel(model);
+        // bounds depend on the model, refresh them with the transform
+        gameObjectManager->markTransformDirty(index);
+    }
+
+    Texture *GameObject::diffuseMap() const {
+        return gameObjectManager->getTexture(gameObjectManager->objects.textures[gameObjectManager->indexOf(id)]);
+    }
+
+    void GameObject::setDiffuseMap(const std::shared_ptr<Texture> &texture) {
+        gameObjectManager->objects.textures[gameObjectManager->indexOf(id)] =
+                gameObjectManager->registerTexture(texture);
+    }
+
+    PointLightComponent *GameObject::pointLight() const {
+        uint32_t lightIndex = gameObjectManager->objects.pointLights[gameObjectManager->indexOf(id)];
+        return lightIndex == INVALID_HANDLE ? nullptr : &gameObjectManager->pointLights.lights[lightIndex];
+    }
+
+    void GameObject::setParent(GameObject parent) {
+        gameObjectManager->setParent(id, parent.getId());
     }
 
-    VkDescriptorBufferInfo GameObject::getBufferInfo(int frameIndex) {
-        return gameObjectManger.getBufferInfoForGameObject(frameIndex, id);
+    void GameObject::clearParent() {
+        gameObjectManager->clearParent(id);
     }
 
-    GameObject::GameObject(id_t objId, const GameObjectManager &manager)
-            : id{objId}, gameObjectManger{manager} {}
+    GameObject::GameObject(id_t objId, GameObjectManager &manager)
+            : id{objId}, gameObjectManager{&manager} {}
 
-}  // namespace lve
\ No newline at end of file
+}  // namespace lve
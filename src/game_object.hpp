@@ -1,81 +1,203 @@
 #pragma once
 
+#include "dynamic_bvh.hpp"
+#include "job_system.hpp"
+#include "mesh_pool.hpp"
 #include "model.hpp"
+#include "scene_file.hpp"
+#include "sparse_set.hpp"
 #include "texture.hpp"
+#include "texture_table.hpp"
+#include "transform.hpp"
 #include "vulkan/swap_chain.hpp"
 
 // libs
 #include <glm/gtc/matrix_transform.hpp>
 
 // std
+#include <cassert>
+#include <cmath>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 namespace Ocean {
 
-    struct TransformComponent {
-        glm::vec3 translation{};
-        glm::vec3 scale{1.f, 1.f, 1.f};
-        glm::vec3 rotation{};
-
-        // Matrix corrsponds to Translate * Ry * Rx * Rz * Scale
-        // Rotations correspond to Tait-bryan angles of Y(1), X(2), Z(3)
-        // https://en.wikipedia.org/wiki/Euler_angles#Rotation_matrix
-        glm::mat4 mat4() const;
+    struct PointLightComponent {
+        // irradiance below which a light is cut off, sets the default range
+        static constexpr float MIN_IRRADIANCE = 0.01f;
 
-        glm::mat3 normalMatrix() const;
-    };
+        [[nodiscard]] static float defaultRange(float intensity) { return std::sqrt(intensity / MIN_IRRADIANCE); }
 
-    struct PointLightComponent {
         float lightIntensity = 1.0f;
+        float range = defaultRange(1.0f);  // world space distance the light reaches, fades out to 0 there
+        bool castsShadows = true;
+        // layer group in ShadowSystem's shadow maps, assigned every frame, -1 when unshadowed
+        int32_t shadowIndex = -1;
     };
 
-    struct GameObjectBufferData {
-        glm::mat4 modelMatrix{1.f};
-        glm::mat4 normalMatrix{1.f};
-    };
+    // Models and textures are shared between objects, components only store a handle into the
+    // manager's asset tables
+    using ModelHandle = uint32_t;
+    using TextureHandle = uint32_t;
+    static constexpr uint32_t INVALID_HANDLE = ~0u;
 
     class GameObjectManager;  // forward declare game object manager class
 
+    // Lightweight handle to a game object. All component data lives in the manager's
+    // structure-of-arrays storage, so handles are cheap to copy and stay valid as objects move.
     class GameObject {
     public:
+        // Ids are generational: the low INDEX_BITS pick a slot that is recycled once its object is
+        // destroyed, the high bits count reuses of that slot so stale ids can be detected
         using id_t = unsigned int;
-        using Map = std::unordered_map<id_t, GameObject>;
 
-        GameObject(GameObject &&) = default;
+        static constexpr uint32_t INDEX_BITS = 22;
+        static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+        static constexpr uint32_t GENERATION_MASK = ~0u >> INDEX_BITS;
+        // the all ones slot is never handed out, so no id can equal INVALID_HANDLE
+        static constexpr uint32_t MAX_SLOTS = INDEX_MASK;
 
-        GameObject(const GameObject &) = delete;
+        static uint32_t slotOf(id_t id) { return id & INDEX_MASK; }
 
-        GameObject &operator=(const GameObject &) = delete;
+        static uint32_t generationOf(id_t id) { return id >> INDEX_BITS; }
 
-        GameObject &operator=(GameObject &&) = delete;
+        static id_t makeId(uint32_t slot, uint32_t generation) {
+            return (generation & GENERATION_MASK) << INDEX_BITS | slot;
+        }
 
         id_t getId() const { return id; }
 
-        VkDescriptorBufferInfo getBufferInfo(int frameIndex);
+        // transform component
+        glm::vec3 &translation();
+
+        glm::vec3 &rotation();
+
+        glm::vec3 &scale();
 
-        glm::vec3 color{};
-        TransformComponent transform{};
+        [[nodiscard]] TransformComponent transform() const;
 
-        // Optional pointer components
-        std::shared_ptr<Model> model{};
-        std::shared_ptr<Texture> diffuseMap = nullptr;
-        std::unique_ptr<PointLightComponent> pointLight = nullptr;
+        glm::vec3 &color();
+
+        // optional components
+        [[nodiscard]] Model *model() const;
+
+        void setModel(const std::shared_ptr<Model> &model);
+
+        [[nodiscard]] Texture *diffuseMap() const;
+
+        void setDiffuseMap(const std::shared_ptr<Texture> &texture);
+
+        [[nodiscard]] PointLightComponent *pointLight() const;
+
+        // hierarchy, the transform becomes relative to the parent
+        void setParent(GameObject parent);
+
+        void clearParent();
 
     private:
-        GameObject(id_t objId, const GameObjectManager &manager);
+        GameObject(id_t objId, GameObjectManager &manager);
 
         id_t id;
-        const GameObjectManager &gameObjectManger;
+        GameObjectManager *gameObjectManager;
 
         friend class GameObjectManager;
     };
 
+    // Dense component arrays, index i of every array belongs to the same game object.
+    // Systems iterate these linearly instead of chasing per-object allocations.
+    struct GameObjectStorage {
+        std::vector<GameObject::id_t> ids;
+        std::vector<glm::vec3> translations;
+        std::vector<glm::vec3> rotations;
+        std::vector<glm::vec3> scales;
+        std::vector<glm::vec3> colors;
+        std::vector<ModelHandle> models;
+        std::vector<TextureHandle> textures;
+        std::vector<uint32_t> pointLights;  // index into PointLightStorage or INVALID_HANDLE
+
+        // hierarchy, objects are kept in depth first pre-order so a parent always comes before its
+        // children and a subtree is the contiguous range [i, i + subtreeSizes[i])
+        std::vector<GameObject::id_t> parentIds;  // INVALID_HANDLE for roots
+        std::vector<uint32_t> parents;  // dense index of the parent, rebuilt when the order changes
+        std::vector<uint32_t> subtreeSizes;  // including the object itself
+
+        // matrices last computed from the transform, only valid once updateBuffer has run
+        std::vector<GameObjectBufferData> localData;  // relative to the parent
+        std::vector<GameObjectBufferData> bufferData;  // world space, what the shaders read
+        std::vector<AABB> worldBounds;  // empty for objects without a model or light
+        // sphere around worldBounds, one array per component for SIMD culling. The radius is
+        // negative infinity for empty bounds
+        std::vector<float> sphereCentersX;
+        std::vector<float> sphereCentersY;
+        std::vector<float> sphereCentersZ;
+        std::vector<float> sphereRadii;
+        std::vector<uint32_t> bvhProxies;  // leaf in the spatial index or DynamicBvh::INVALID_NODE
+        // one bit per frame in flight whose buffer is out of date, plus TRANSFORM_STALE
+        std::vector<uint8_t> dirtyFrames;
+        std::vector<uint32_t> movedAt;  // updateBuffer call that last changed the world transform
+
+        [[nodiscard]] uint32_t size() const { return static_cast<uint32_t>(ids.size()); }
+
+        // calls fn on every array above, for operations that move whole objects
+        template<typename Fn>
+        void forEachArray(Fn &&fn) {
+            fn(ids);
+            fn(translations);
+            fn(rotations);
+            fn(scales);
+            fn(colors);
+            fn(models);
+            fn(textures);
+            fn(pointLights);
+            fn(parentIds);
+            fn(parents);
+            fn(subtreeSizes);
+            fn(localData);
+            fn(bufferData);
+            fn(worldBounds);
+            fn(sphereCentersX);
+            fn(sphereCentersY);
+            fn(sphereCentersZ);
+            fn(sphereRadii);
+            fn(bvhProxies);
+            fn(dirtyFrames);
+            fn(movedAt);
+        }
+    };
+
+    // world bounds as read by cull.comp, w is unused
+    struct GameObjectBounds {
+        glm::vec4 min;
+        glm::vec4 max;
+    };
+
+    struct PointLightStorage {
+        std::vector<uint32_t> objectIndices;  // dense index of the owning game object
+        std::vector<PointLightComponent> lights;
+
+        [[nodiscard]] uint32_t size() const { return static_cast<uint32_t>(lights.size()); }
+    };
+
     class GameObjectManager {
     public:
-        static constexpr int MAX_GAME_OBJECTS = 1000;
+        // per-object storage buffers start at this many slots and double whenever they fill up
+        static constexpr uint32_t INITIAL_OBJECT_CAPACITY = 1024;
+
+        // set in dirtyFrames when bufferData no longer matches the transform
+        static constexpr uint8_t TRANSFORM_STALE = 1u << 7;
+        static constexpr uint8_t ALL_FRAMES_DIRTY = (1u << SwapChain::MAX_FRAMES_IN_FLIGHT) - 1;
+        static_assert(SwapChain::MAX_FRAMES_IN_FLIGHT < 8, "dirtyFrames holds one bit per frame in flight");
 
-        explicit GameObjectManager(Device &device);
+        // subtrees at least this large have their child subtrees updated on several threads
+        static constexpr uint32_t PARALLEL_SUBTREE_SIZE = 4096;
+        // smallest number of transforms computed by one job
+        static constexpr uint32_t TRANSFORM_BATCH_SIZE = 1024;
+        // objects whose world transform has not changed for this many updateBuffer calls count as
+        // static, e.g. for shadow caching
+        static constexpr uint32_t STATIC_UPDATE_COUNT = 60;
+
+        GameObjectManager(Device &device, JobSystem &jobSystem);
 
         GameObjectManager(const GameObjectManager &) = delete;
 
@@ -85,31 +207,149 @@ namespace Ocean {
 
         GameObjectManager &operator=(GameObjectManager &&) = delete;
 
-        GameObject &createGameObject() {
-            assert(currentId < MAX_GAME_OBJECTS && "Max game object count exceeded!");
-            auto gameObject = GameObject{currentId++, *this};
-            auto gameObjectId = gameObject.getId();
-            gameObject.diffuseMap = textureDefault;
-            gameObjects.emplace(gameObjectId, std::move(gameObject));
-            return gameObjects.at(gameObjectId);
-        }
+        GameObject createGameObject();
 
-        GameObject &makePointLight(
+        GameObject makePointLight(
                 float intensity = 10.f, float radius = 0.1f, glm::vec3 color = glm::vec3(1.f));
 
-        [[nodiscard]] VkDescriptorBufferInfo getBufferInfoForGameObject(
-                int frameIndex, GameObject::id_t gameObjectId) const {
-            return uboBuffers[frameIndex]->descriptorInfoForIndex(gameObjectId);
+        // Appends every object of a scene file, models and textures hold the handles registered
+        // for the scene's paths. Returns the new ids in scene order.
+        std::vector<GameObject::id_t> loadScene(
+                const SceneFile &scene,
+                const std::vector<ModelHandle> &models,
+                const std::vector<TextureHandle> &textures);
+
+        // Destroys the object and all of its children. The slot is recycled by a later
+        // createGameObject, and the last object moves into the freed dense index so the
+        // component arrays and GPU buffers stay compact.
+        void destroyGameObject(GameObject::id_t id);
+
+        [[nodiscard]] bool isAlive(GameObject::id_t id) const {
+            uint32_t slot = GameObject::slotOf(id);
+            return slot < slotGenerations.size() && slotGenerations[slot] == GameObject::generationOf(id) &&
+                   objectIndex.contains(slot);
+        }
+
+        [[nodiscard]] GameObject getGameObject(GameObject::id_t id) {
+            assert(isAlive(id) && "Game object does not exist");
+            return GameObject{id, *this};
         }
 
+        [[nodiscard]] uint32_t indexOf(GameObject::id_t id) const {
+            assert(isAlive(id) && "Stale game object id");
+            return objectIndex.indexOf(GameObject::slotOf(id));
+        }
+
+        // storage is reordered on the next updateBuffer, dense indices held until then stay valid
+        void setParent(GameObject::id_t child, GameObject::id_t parent);
+
+        void clearParent(GameObject::id_t child);
+
+        // Leaves hold the game object id and fattened world bounds of every object with a model or
+        // point light. Kept in sync by updateBuffer, query it after that ran this frame.
+        [[nodiscard]] const DynamicBvh &getSpatialIndex() const { return spatialIndex; }
+
+        [[nodiscard]] bool isStatic(uint32_t index) const {
+            return updateCount - objects.movedAt[index] >= STATIC_UPDATE_COUNT;
+        }
+
+        // world space position, only valid once updateBuffer has run this frame
+        [[nodiscard]] glm::vec3 worldTranslation(uint32_t index) const {
+            return glm::vec3{objects.bufferData[index].modelMatrix[3]};
+        }
+
+        // largest world space scale factor, the longest basis vector of the world matrix. Only
+        // valid once updateBuffer has run this frame
+        [[nodiscard]] float worldScale(uint32_t index) const {
+            const auto &world = objects.bufferData[index].modelMatrix;
+            return glm::max(
+                    glm::length(glm::vec3{world[0]}),
+                    glm::max(glm::length(glm::vec3{world[1]}), glm::length(glm::vec3{world[2]})));
+        }
+
+        // whole object buffer of a frame, a tightly packed GameObjectBufferData array indexed by
+        // dense index, not by id
+        [[nodiscard]] VkDescriptorBufferInfo getObjectBufferInfo(int frameIndex) const {
+            return objectBuffers[frameIndex]->descriptorInfo();
+        }
+
+        // GameObjectBounds of every object, indexed like the object buffer
+        [[nodiscard]] VkDescriptorBufferInfo getBoundsBufferInfo(int frameIndex) const {
+            return boundsBuffers[frameIndex]->descriptorInfo();
+        }
+
+        ModelHandle registerModel(const std::shared_ptr<Model> &model);
+
+        TextureHandle registerTexture(const std::shared_ptr<Texture> &texture);
+
+        // holds the geometry of every registered model, mesh index == model handle
+        [[nodiscard]] const MeshPool &getMeshPool() const { return meshPool; }
+
+        // descriptor set of every registered texture, array index == texture handle
+        [[nodiscard]] const TextureTable &getTextureTable() const { return textureTable; }
+
+        [[nodiscard]] Model *getModel(ModelHandle handle) const {
+            return handle == INVALID_HANDLE ? nullptr : modelAssets[handle].get();
+        }
+
+        [[nodiscard]] Texture *getTexture(TextureHandle handle) const {
+            return handle == INVALID_HANDLE ? nullptr : textureAssets[handle].get();
+        }
+
+        // must be called after writing to a transform array directly, the handle accessors do this
+        void markTransformDirty(uint32_t index);
+
+        // recomputes and uploads only objects whose transform changed since this frame's buffer
+        // was last written
         void updateBuffer(int frameIndex);
 
-        GameObject::Map gameObjects{};
-        std::vector<std::unique_ptr<OceanBuffer>> uboBuffers{SwapChain::MAX_FRAMES_IN_FLIGHT};
+        GameObjectStorage objects{};
+        PointLightStorage pointLights{};
+        std::vector<std::unique_ptr<OceanBuffer>> objectBuffers{SwapChain::MAX_FRAMES_IN_FLIGHT};
 
     private:
-        GameObject::id_t currentId = 0;
-        std::shared_ptr<Texture> textureDefault;
+        std::unique_ptr<OceanBuffer> createObjectBuffer(VkDeviceSize elementSize, uint32_t capacity) const;
+
+        void reserveObjectBuffer(int frameIndex, uint32_t objectCount);
+
+        void markFrameDirty(uint32_t index, uint8_t frameBits);
+
+        GameObject::id_t allocateId(uint32_t index);
+
+        void removeAt(uint32_t index);
+
+        void removePointLight(uint32_t lightIndex);
+
+        void sortHierarchy();
+
+        void updateWorldSubtree(uint32_t root);
+
+        void updateWorldRange(uint32_t first, uint32_t last);
+
+        void updateBounds(uint32_t index);
+
+        Device &device;
+        JobSystem &jobSystem;
+        std::vector<std::unique_ptr<OceanBuffer>> boundsBuffers{SwapChain::MAX_FRAMES_IN_FLIGHT};
+        std::vector<uint32_t> dirtyIndices;  // objects with any bit set in dirtyFrames
+        bool hierarchyChanged = false;  // storage is no longer in pre-order
+        uint32_t parentedCount = 0;  // objects with a parent
+        uint32_t updateCount = 0;  // updateBuffer calls so far
+        DynamicBvh spatialIndex;
+        // scratch for updateBuffer, kept to reuse their capacity
+        std::vector<uint32_t> staleIndices;
+        std::vector<uint32_t> writtenIndices;
+        SparseSet objectIndex;  // game object slot -> index into objects
+        std::vector<uint32_t> slotGenerations;  // current generation of every slot handed out
+        std::vector<uint32_t> freeSlots;
+
+        MeshPool meshPool;
+        std::vector<std::shared_ptr<Model>> modelAssets;
+        std::unordered_map<const Model *, ModelHandle> modelHandles;
+        TextureTable textureTable;
+        std::vector<std::shared_ptr<Texture>> textureAssets;
+        std::unordered_map<const Texture *, TextureHandle> textureHandles;
+        TextureHandle textureDefault = INVALID_HANDLE;
     };
 
 }  // namespace lve
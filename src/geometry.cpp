@@ -0,0 +1,81 @@
+#include "geometry.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+
+namespace Ocean {
+
+    AABB AABB::transformed(const glm::mat4 &matrix) const {
+        // Arvo's method, each output axis is the translation plus the extremes of every
+        // column scaled by the matching input interval
+        AABB result{glm::vec3{matrix[3]}, glm::vec3{matrix[3]}};
+        for (int column = 0; column < 3; column++) {
+            glm::vec3 a = glm::vec3{matrix[column]} * min[column];
+            glm::vec3 b = glm::vec3{matrix[column]} * max[column];
+            result.min += glm::min(a, b);
+            result.max += glm::max(a, b);
+        }
+        return result;
+    }
+
+    bool Sphere::intersects(const AABB &box) const {
+        glm::vec3 closest = glm::clamp(center, box.min, box.max);
+        glm::vec3 offset = center - closest;
+        return glm::dot(offset, offset) <= radius * radius;
+    }
+
+    float Ray::intersect(const AABB &box, float maxDistance) const {
+        // slab test, division by zero yields infinities which compare correctly
+        float tMin = 0.f;
+        float tMax = maxDistance;
+        for (int axis = 0; axis < 3; axis++) {
+            float invDirection = 1.f / direction[axis];
+            float t0 = (box.min[axis] - origin[axis]) * invDirection;
+            float t1 = (box.max[axis] - origin[axis]) * invDirection;
+            if (invDirection < 0.f) std::swap(t0, t1);
+            tMin = std::max(tMin, t0);
+            tMax = std::min(tMax, t1);
+            if (tMax < tMin) return -1.f;
+        }
+        return tMin;
+    }
+
+    Frustum Frustum::fromViewProjection(const glm::mat4 &viewProjection) {
+        // Gribb/Hartmann plane extraction, glm matrices are column major so row i is m[*][i]
+        auto row = [&](int i) {
+            return glm::vec4{viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]};
+        };
+        Frustum frustum{};
+        frustum.planes[0] = row(3) + row(0);
+        frustum.planes[1] = row(3) - row(0);
+        frustum.planes[2] = row(3) + row(1);
+        frustum.planes[3] = row(3) - row(1);
+        frustum.planes[4] = row(2);  // depth is [0, w], not [-w, w]
+        frustum.planes[5] = row(3) - row(2);
+        for (auto &plane: frustum.planes) {
+            plane /= glm::length(glm::vec3{plane});
+        }
+        return frustum;
+    }
+
+    bool Frustum::intersects(const AABB &box) const {
+        for (const auto &plane: planes) {
+            // test the corner furthest along the plane normal
+            glm::vec3 corner{
+                    plane.x >= 0.f ? box.max.x : box.min.x,
+                    plane.y >= 0.f ? box.max.y : box.min.y,
+                    plane.z >= 0.f ? box.max.z : box.min.z};
+            if (glm::dot(glm::vec3{plane}, corner) + plane.w < 0.f) return false;
+        }
+        return true;
+    }
+
+    bool Frustum::intersects(const Sphere &sphere) const {
+        for (const auto &plane: planes) {
+            if (glm::dot(glm::vec3{plane}, sphere.center) + plane.w < -sphere.radius) return false;
+        }
+        return true;
+    }
+
+}  // namespace Ocean
@@ -0,0 +1,82 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <limits>
+
+namespace Ocean {
+
+    struct AABB {
+        // default constructed box is empty, merging anything into it yields that thing
+        glm::vec3 min{std::numeric_limits<float>::max()};
+        glm::vec3 max{-std::numeric_limits<float>::max()};
+
+        [[nodiscard]] bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+
+        [[nodiscard]] glm::vec3 center() const { return (min + max) * 0.5f; }
+
+        [[nodiscard]] glm::vec3 extent() const { return (max - min) * 0.5f; }
+
+        [[nodiscard]] float surfaceArea() const {
+            glm::vec3 d = max - min;
+            return 2.f * (d.x * d.y + d.y * d.z + d.z * d.x);
+        }
+
+        void expand(const glm::vec3 &point) {
+            min = glm::min(min, point);
+            max = glm::max(max, point);
+        }
+
+        [[nodiscard]] bool contains(const AABB &other) const {
+            return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+                   max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+        }
+
+        [[nodiscard]] bool intersects(const AABB &other) const {
+            return min.x <= other.max.x && max.x >= other.min.x &&
+                   min.y <= other.max.y && max.y >= other.min.y &&
+                   min.z <= other.max.z && max.z >= other.min.z;
+        }
+
+        // bounds of this box after transforming it by matrix
+        [[nodiscard]] AABB transformed(const glm::mat4 &matrix) const;
+
+        static AABB merge(const AABB &a, const AABB &b) {
+            return AABB{glm::min(a.min, b.min), glm::max(a.max, b.max)};
+        }
+    };
+
+    struct Sphere {
+        glm::vec3 center{};
+        float radius = 0.f;
+
+        [[nodiscard]] bool intersects(const AABB &box) const;
+    };
+
+    struct Ray {
+        glm::vec3 origin{};
+        glm::vec3 direction{0.f, 0.f, 1.f};
+
+        // distance along the ray where it enters box, or a negative value on a miss
+        [[nodiscard]] float intersect(const AABB &box, float maxDistance) const;
+    };
+
+    struct Frustum {
+        // left, right, bottom, top, near, far. xyz is the inward facing normal, w the distance
+        std::array<glm::vec4, 6> planes{};
+
+        // planes of a projection * view matrix with a [0, 1] depth range
+        static Frustum fromViewProjection(const glm::mat4 &viewProjection);
+
+        [[nodiscard]] bool intersects(const AABB &box) const;
+
+        [[nodiscard]] bool intersects(const Sphere &sphere) const;
+    };
+
+}  // namespace Ocean
@@ -0,0 +1,231 @@
+#include "job_system.hpp"
+
+// std
+#include <cassert>
+#include <chrono>
+
+namespace Ocean {
+
+    namespace {
+
+        // identifies the pool and queue of worker threads
+        thread_local const JobSystem *currentSystem = nullptr;
+        thread_local uint32_t currentQueueIndex = 0;
+
+        uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start) {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count());
+        }
+
+    }  // namespace
+
+    JobSystem::JobSystem(uint32_t workerCount) : mainThreadId{std::this_thread::get_id()} {
+        queues.reserve(workerCount + 1);
+        for (uint32_t i = 0; i <= workerCount; i++) {
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+        workers.reserve(workerCount);
+        for (uint32_t i = 1; i <= workerCount; i++) {
+            workers.emplace_back([this, i]() { workerLoop(i); });
+        }
+    }
+
+    JobSystem::~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock{wakeMutex};
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+        for (auto &worker: workers) {
+            worker.join();
+        }
+        // jobs submitted by the main thread that never got to run
+        while (runOneJob(0)) {}
+    }
+
+    void JobSystem::submit(std::function<void()> job, JobCounter *counter) {
+        push(currentQueue(), std::move(job), counter);
+        wakeWorkers(false);
+    }
+
+    void JobSystem::submitAfter(JobCounter &dependency, std::function<void()> job, JobCounter *counter) {
+        if (counter != nullptr) {
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        }
+        {
+            std::lock_guard<std::mutex> lock{dependency.mutex};
+            if (!dependency.isDone()) {
+                dependency.continuations.emplace_back(std::move(job), counter);
+                return;
+            }
+        }
+        enqueue(currentQueue(), Job{std::move(job), counter});
+        wakeWorkers(false);
+    }
+
+    void JobSystem::runOnMainThread(std::function<void()> job, JobCounter *counter) {
+        if (counter != nullptr) {
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        }
+        std::lock_guard<std::mutex> lock{mainThreadMutex};
+        mainThreadJobs.push_back(Job{std::move(job), counter});
+    }
+
+    void JobSystem::runMainThreadJobs() {
+        assert(isMainThread() && "Main thread jobs must run on the main thread");
+        std::vector<Job> jobs;
+        {
+            std::lock_guard<std::mutex> lock{mainThreadMutex};
+            jobs.swap(mainThreadJobs);
+        }
+        for (auto &job: jobs) {
+            job.task();
+            queues[0]->jobsRun.fetch_add(1, std::memory_order_relaxed);
+            finish(job.counter);
+        }
+    }
+
+    void JobSystem::wait(JobCounter &counter) {
+        uint32_t queueIndex = currentQueue();
+        bool mainThread = isMainThread();
+        while (!counter.isDone()) {
+            if (mainThread) {
+                runMainThreadJobs();
+            }
+            if (!runOneJob(queueIndex)) {
+                auto idleStart = std::chrono::steady_clock::now();
+                std::this_thread::yield();
+                queues[queueIndex]->idleNanoseconds.fetch_add(nanosecondsSince(idleStart), std::memory_order_relaxed);
+            }
+        }
+        // the thread that finished the last job may still hold the lock, don't let the
+        // caller destroy the counter under it
+        std::lock_guard<std::mutex> lock{counter.mutex};
+    }
+
+    JobStats JobSystem::getStats() const {
+        JobStats stats{};
+        for (const auto &queue: queues) {
+            stats.jobsRun += queue->jobsRun.load(std::memory_order_relaxed);
+            stats.steals += queue->steals.load(std::memory_order_relaxed);
+            stats.idleMilliseconds += static_cast<double>(queue->idleNanoseconds.load(std::memory_order_relaxed)) * 1e-6;
+        }
+        return stats;
+    }
+
+    void JobSystem::resetStats() {
+        for (auto &queue: queues) {
+            queue->jobsRun.store(0, std::memory_order_relaxed);
+            queue->steals.store(0, std::memory_order_relaxed);
+            queue->idleNanoseconds.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void JobSystem::workerLoop(uint32_t queueIndex) {
+        currentSystem = this;
+        currentQueueIndex = queueIndex;
+        while (true) {
+            if (runOneJob(queueIndex)) continue;
+
+            auto idleStart = std::chrono::steady_clock::now();
+            std::unique_lock<std::mutex> lock{wakeMutex};
+            if (stopping) break;
+            wakeCondition.wait(lock, [this]() {
+                return stopping || queuedJobs.load(std::memory_order_acquire) > 0;
+            });
+            lock.unlock();
+            queues[queueIndex]->idleNanoseconds.fetch_add(nanosecondsSince(idleStart), std::memory_order_relaxed);
+        }
+    }
+
+    uint32_t JobSystem::currentQueue() const {
+        return currentSystem == this ? currentQueueIndex : 0;
+    }
+
+    void JobSystem::push(uint32_t queueIndex, std::function<void()> task, JobCounter *counter) {
+        if (counter != nullptr) {
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        }
+        enqueue(queueIndex, Job{std::move(task), counter});
+    }
+
+    void JobSystem::enqueue(uint32_t queueIndex, Job job) {
+        {
+            std::lock_guard<std::mutex> lock{queues[queueIndex]->mutex};
+            queues[queueIndex]->jobs.push_back(std::move(job));
+        }
+        queuedJobs.fetch_add(1, std::memory_order_release);
+    }
+
+    void JobSystem::wakeWorkers(bool all) {
+        if (workers.empty()) return;
+        // a worker checks queuedJobs under the lock before it sleeps, taking the lock here
+        // orders the notify after that check so the wake up can't be lost
+        { std::lock_guard<std::mutex> lock{wakeMutex}; }
+        if (all) {
+            wakeCondition.notify_all();
+        } else {
+            wakeCondition.notify_one();
+        }
+    }
+
+    bool JobSystem::runOneJob(uint32_t queueIndex) {
+        Job job;
+        bool found = false;
+        {
+            // newest job first, its data is most likely still in cache
+            WorkQueue &own = *queues[queueIndex];
+            std::lock_guard<std::mutex> lock{own.mutex};
+            if (!own.jobs.empty()) {
+                job = std::move(own.jobs.back());
+                own.jobs.pop_back();
+                found = true;
+            }
+        }
+        if (!found) {
+            // steal the oldest job of another queue, starting at a different victim each time
+            auto count = static_cast<uint32_t>(queues.size());
+            uint32_t start = stealSeed.fetch_add(1, std::memory_order_relaxed);
+            for (uint32_t i = 0; i < count && !found; i++) {
+                uint32_t victim = (start + i) % count;
+                if (victim == queueIndex) continue;
+                WorkQueue &other = *queues[victim];
+                std::lock_guard<std::mutex> lock{other.mutex};
+                if (!other.jobs.empty()) {
+                    job = std::move(other.jobs.front());
+                    other.jobs.pop_front();
+                    found = true;
+                }
+            }
+            if (!found) return false;
+            queues[queueIndex]->steals.fetch_add(1, std::memory_order_relaxed);
+        }
+        queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+
+        job.task();
+        queues[queueIndex]->jobsRun.fetch_add(1, std::memory_order_relaxed);
+        finish(job.counter);
+        return true;
+    }
+
+    void JobSystem::finish(JobCounter *counter) {
+        if (counter == nullptr) return;
+
+        std::vector<std::pair<std::function<void()>, JobCounter *>> ready;
+        {
+            std::lock_guard<std::mutex> lock{counter->mutex};
+            if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                ready.swap(counter->continuations);
+            }
+        }
+        if (ready.empty()) return;
+
+        // counter may be gone once the lock is released, only touch the continuations now
+        uint32_t queueIndex = currentQueue();
+        for (auto &[task, continuationCounter]: ready) {
+            enqueue(queueIndex, Job{std::move(task), continuationCounter});
+        }
+        wakeWorkers(ready.size() > 1);
+    }
+
+}  // namespace Ocean
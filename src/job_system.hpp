@@ -0,0 +1,154 @@
+#pragma once
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Ocean {
+
+    // Counts jobs that have not finished yet. Jobs submitted with a counter increment it and
+    // decrement it when done, so waiting on the counter waits on all of them. Jobs can also be
+    // held back until a counter reaches zero.
+    class JobCounter {
+    public:
+        JobCounter() = default;
+
+        JobCounter(const JobCounter &) = delete;
+
+        JobCounter &operator=(const JobCounter &) = delete;
+
+        [[nodiscard]] bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class JobSystem;
+
+        std::atomic<uint32_t> pending{0};
+        std::mutex mutex;  // guards continuations and the final decrement
+        std::vector<std::pair<std::function<void()>, JobCounter *>> continuations;
+    };
+
+    struct JobStats {
+        uint64_t jobsRun = 0;
+        uint64_t steals = 0;
+        double idleMilliseconds = 0.0;
+    };
+
+    // Work stealing thread pool. Every worker owns a deque, it pushes and pops its own jobs at the
+    // back and steals from the front of other deques when it runs dry. The thread that creates the
+    // JobSystem is the main thread: it has a deque too and runs jobs while it waits, and it is
+    // the only thread that runs jobs submitted with runOnMainThread, e.g. GLFW calls.
+    class JobSystem {
+    public:
+        // workerCount excludes the main thread, 0 runs every job on the main thread
+        explicit JobSystem(uint32_t workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1);
+
+        ~JobSystem();
+
+        JobSystem(const JobSystem &) = delete;
+
+        JobSystem &operator=(const JobSystem &) = delete;
+
+        void submit(std::function<void()> job, JobCounter *counter = nullptr);
+
+        // job is submitted once dependency reaches zero
+        void submitAfter(JobCounter &dependency, std::function<void()> job, JobCounter *counter = nullptr);
+
+        void runOnMainThread(std::function<void()> job, JobCounter *counter = nullptr);
+
+        // runs queued main thread jobs, call once per frame from the main thread
+        void runMainThreadJobs();
+
+        // runs other jobs until counter reaches zero
+        void wait(JobCounter &counter);
+
+        // splits [begin, end) into chunks of at least grain elements and calls fn(first, last) for
+        // each of them in parallel, returns once every chunk is done. The calling thread runs the
+        // first chunk itself
+        template<typename Fn>
+        void parallelFor(uint32_t begin, uint32_t end, uint32_t grain, Fn &&fn) {
+            if (begin >= end) return;
+            grain = std::max(grain, 1u);
+            if (end - begin <= grain || workers.empty()) {
+                fn(begin, end);
+                return;
+            }
+
+            // no more chunks than threads times a few, so small grains don't flood the deques
+            uint32_t maxChunks = 4 * getThreadCount();
+            uint32_t chunkSize = std::max(grain, (end - begin + maxChunks - 1) / maxChunks);
+            JobCounter counter;
+            for (uint32_t first = begin + chunkSize; first < end; first += chunkSize) {
+                uint32_t last = std::min(first + chunkSize, end);
+                push(currentQueue(), [&fn, first, last]() { fn(first, last); }, &counter);
+            }
+            wakeWorkers();
+            fn(begin, std::min(begin + chunkSize, end));
+            wait(counter);
+        }
+
+        [[nodiscard]] uint32_t getThreadCount() const { return static_cast<uint32_t>(queues.size()); }
+
+        [[nodiscard]] bool isMainThread() const { return std::this_thread::get_id() == mainThreadId; }
+
+        // totals over every thread since the last reset
+        [[nodiscard]] JobStats getStats() const;
+
+        void resetStats();
+
+    private:
+        struct Job {
+            std::function<void()> task;
+            JobCounter *counter = nullptr;
+        };
+
+        // padded so threads updating their own stats don't share cache lines
+        struct alignas(64) WorkQueue {
+            std::mutex mutex;
+            std::deque<Job> jobs;
+            std::atomic<uint64_t> jobsRun{0};
+            std::atomic<uint64_t> steals{0};
+            std::atomic<uint64_t> idleNanoseconds{0};
+        };
+
+        void workerLoop(uint32_t queueIndex);
+
+        // index of the calling thread's queue, threads outside the pool share the main queue
+        [[nodiscard]] uint32_t currentQueue() const;
+
+        // counts the job on its counter and queues it, wakeWorkers has to follow
+        void push(uint32_t queueIndex, std::function<void()> task, JobCounter *counter);
+
+        void enqueue(uint32_t queueIndex, Job job);
+
+        void wakeWorkers(bool all = true);
+
+        // pops from the own queue first then steals, returns false if there was nothing to run
+        bool runOneJob(uint32_t queueIndex);
+
+        void finish(JobCounter *counter);
+
+        std::vector<std::unique_ptr<WorkQueue>> queues;  // 0 belongs to the main thread
+        std::vector<std::thread> workers;
+        std::thread::id mainThreadId;
+
+        std::mutex mainThreadMutex;
+        std::vector<Job> mainThreadJobs;
+
+        // sleeping workers wait for queuedJobs to become non zero
+        std::mutex wakeMutex;
+        std::condition_variable wakeCondition;
+        std::atomic<uint32_t> queuedJobs{0};
+        std::atomic<uint32_t> stealSeed{0};
+        bool stopping = false;
+    };
+
+}  // namespace Ocean
@@ -19,7 +19,7 @@ namespace Ocean {
             int lookDown = GLFW_KEY_DOWN;
         };
 
-        void moveInPlaneXZ(GLFWwindow *window, float dt, GameObject &gameObject) const;
+        void moveInPlaneXZ(GLFWwindow *window, float dt, GameObject gameObject) const;
 
         KeyMappings keys{};
         float moveSpeed{3.f};
@@ -0,0 +1,190 @@
+#include "light_cluster_grid.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Ocean {
+
+    namespace {
+
+        constexpr uint32_t INITIAL_LIGHT_CAPACITY = 64;
+        constexpr uint32_t INITIAL_LIGHT_INDEX_CAPACITY = 1024;
+        // smallest number of lights bounded by one job
+        constexpr uint32_t BOUND_BATCH_SIZE = 256;
+
+        // cluster coordinate of a position along one axis, clamped to the grid
+        uint32_t clusterOf(float position, uint32_t count) {
+            return static_cast<uint32_t>(std::clamp(position, 0.f, static_cast<float>(count - 1)));
+        }
+
+    }  // namespace
+
+    LightClusterGrid::LightClusterGrid(Device &device) : device{device} {
+        setLayout =
+                DescriptorSetLayout::Builder(device)
+                        .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                        .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                        .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                        .addBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                        .build();
+        for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+            OceanBuffer::reserve(
+                    device, lightBuffers[i], sizeof(PointLight), INITIAL_LIGHT_CAPACITY,
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+            OceanBuffer::reserve(
+                    device, clusterBuffers[i], sizeof(ClusterRange), CLUSTER_COUNT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+            OceanBuffer::reserve(
+                    device, lightIndexBuffers[i], sizeof(uint32_t), INITIAL_LIGHT_INDEX_CAPACITY,
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        }
+    }
+
+    void LightClusterGrid::build(FrameInfo &frameInfo, VkDescriptorImageInfo shadowMapInfo) {
+        auto &manager = frameInfo.gameObjectManager;
+        const auto &pointLights = manager.pointLights;
+        lights.resize(pointLights.size());
+        for (uint32_t lightIndex = 0; lightIndex < pointLights.size(); lightIndex++) {
+            uint32_t objIndex = pointLights.objectIndices[lightIndex];
+            const auto &light = pointLights.lights[lightIndex];
+            lights[lightIndex].position = glm::vec4(manager.worldTranslation(objIndex), light.range);
+            lights[lightIndex].color = glm::vec4(manager.objects.colors[objIndex], light.lightIntensity);
+            lights[lightIndex].shadow = glm::ivec4(light.shadowIndex, 0, 0, 0);
+        }
+
+        // slices are spaced evenly in log depth, so a cluster's depth grows with its distance
+        const Camera &camera = frameInfo.camera;
+        VkExtent2D extent = frameInfo.renderer.getSwapChainExtent();
+        float logDepthRange = std::log(camera.getFar() / camera.getNear());
+        clusterScale = {
+                static_cast<float>(CLUSTER_COUNT_X) / static_cast<float>(extent.width),
+                static_cast<float>(CLUSTER_COUNT_Y) / static_cast<float>(extent.height),
+                static_cast<float>(CLUSTER_COUNT_Z) / logDepthRange,
+                -static_cast<float>(CLUSTER_COUNT_Z) * std::log(camera.getNear()) / logDepthRange};
+        boundLights(frameInfo);
+
+        // counting sort by cluster: count, turn counts into offsets, then fill. Every job owns
+        // the clusters of its slice, so no two jobs touch the same range
+        clusters.assign(CLUSTER_COUNT, ClusterRange{0, 0});
+        frameInfo.jobSystem.parallelFor(0, CLUSTER_COUNT_Z, 1, [&](uint32_t first, uint32_t last) {
+            for (uint32_t slice = first; slice < last; slice++) binSlice(slice, false);
+        });
+        uint32_t lightIndexCount = 0;
+        for (auto &cluster: clusters) {
+            cluster.offset = lightIndexCount;
+            lightIndexCount += cluster.count;
+            cluster.count = 0;
+        }
+        lightIndices.resize(lightIndexCount);
+        frameInfo.jobSystem.parallelFor(0, CLUSTER_COUNT_Z, 1, [&](uint32_t first, uint32_t last) {
+            for (uint32_t slice = first; slice < last; slice++) binSlice(slice, true);
+        });
+
+        const int frameIndex = frameInfo.frameIndex;
+        auto &lightBuffer = lightBuffers[frameIndex];
+        OceanBuffer::reserve(
+                device, lightBuffer, sizeof(PointLight), static_cast<uint32_t>(lights.size()),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        auto &lightIndexBuffer = lightIndexBuffers[frameIndex];
+        OceanBuffer::reserve(
+                device, lightIndexBuffer, sizeof(uint32_t), lightIndexCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        if (!lights.empty()) {
+            lightBuffer->writeToBuffer(lights.data(), lights.size() * sizeof(PointLight));
+            lightBuffer->flush();
+        }
+        if (lightIndexCount > 0) {
+            lightIndexBuffer->writeToBuffer(lightIndices.data(), lightIndices.size() * sizeof(uint32_t));
+            lightIndexBuffer->flush();
+        }
+        auto &clusterBuffer = *clusterBuffers[frameIndex];
+        clusterBuffer.writeToBuffer(clusters.data(), clusters.size() * sizeof(ClusterRange));
+        clusterBuffer.flush();
+
+        auto lightBufferInfo = lightBuffer->descriptorInfo();
+        auto clusterBufferInfo = clusterBuffer.descriptorInfo();
+        auto lightIndexBufferInfo = lightIndexBuffer->descriptorInfo();
+        DescriptorWriter(*setLayout, frameInfo.descriptorCache)
+                .writeBuffer(0, &lightBufferInfo)
+                .writeBuffer(1, &clusterBufferInfo)
+                .writeBuffer(2, &lightIndexBufferInfo)
+                .writeImage(3, &shadowMapInfo)
+                .build(descriptorSet);
+    }
+
+    void LightClusterGrid::boundLights(FrameInfo &frameInfo) {
+        const glm::mat4 &view = frameInfo.camera.getView();
+        const glm::mat4 &projection = frameInfo.camera.getProjection();
+        const float near = frameInfo.camera.getNear();
+        const float far = frameInfo.camera.getFar();
+        auto sliceOf = [this](float depth) {
+            return clusterOf(std::floor(std::log(depth) * clusterScale.z + clusterScale.w), CLUSTER_COUNT_Z);
+        };
+
+        lightBounds.resize(lights.size());
+        frameInfo.jobSystem.parallelFor(0, lights.size(), BOUND_BATCH_SIZE, [&](uint32_t first, uint32_t last) {
+            for (uint32_t i = first; i < last; i++) {
+                LightBounds &bounds = lightBounds[i];
+                bounds = LightBounds{glm::uvec3{1}, glm::uvec3{0}};
+
+                glm::vec3 center{view * glm::vec4{glm::vec3{lights[i].position}, 1.f}};
+                float range = lights[i].position.w;
+                float minDepth = center.z - range;
+                float maxDepth = center.z + range;
+                if (maxDepth < near || minDepth > far) continue;
+
+                // spheres reaching the near plane get every tile of their slices
+                glm::uvec2 firstTile{0};
+                glm::uvec2 lastTile{CLUSTER_COUNT_X - 1, CLUSTER_COUNT_Y - 1};
+                if (minDepth > near) {
+                    // the sphere's bounding box is in front of the camera, its projection bounds
+                    // the sphere's
+                    glm::vec2 ndcMin{std::numeric_limits<float>::max()};
+                    glm::vec2 ndcMax{std::numeric_limits<float>::lowest()};
+                    for (float depth: {minDepth, maxDepth}) {
+                        for (float sign: {-1.f, 1.f}) {
+                            glm::vec2 ndc{
+                                    projection[0][0] * (center.x + sign * range) / depth,
+                                    projection[1][1] * (center.y + sign * range) / depth};
+                            ndcMin = glm::min(ndcMin, ndc);
+                            ndcMax = glm::max(ndcMax, ndc);
+                        }
+                    }
+                    if (ndcMax.x < -1.f || ndcMax.y < -1.f || ndcMin.x > 1.f || ndcMin.y > 1.f) continue;
+
+                    const glm::vec2 counts{CLUSTER_COUNT_X, CLUSTER_COUNT_Y};
+                    glm::vec2 tileMin = glm::floor((ndcMin * .5f + .5f) * counts);
+                    glm::vec2 tileMax = glm::floor((ndcMax * .5f + .5f) * counts);
+                    firstTile = {clusterOf(tileMin.x, CLUSTER_COUNT_X), clusterOf(tileMin.y, CLUSTER_COUNT_Y)};
+                    lastTile = {clusterOf(tileMax.x, CLUSTER_COUNT_X), clusterOf(tileMax.y, CLUSTER_COUNT_Y)};
+                }
+                bounds.first = {firstTile, sliceOf(std::max(minDepth, near))};
+                bounds.last = {lastTile, sliceOf(std::min(maxDepth, far))};
+            }
+        });
+    }
+
+    void LightClusterGrid::binSlice(uint32_t slice, bool fill) {
+        for (uint32_t i = 0; i < lightBounds.size(); i++) {
+            const LightBounds &bounds = lightBounds[i];
+            if (slice < bounds.first.z || slice > bounds.last.z) continue;
+
+            for (uint32_t y = bounds.first.y; y <= bounds.last.y; y++) {
+                uint32_t row = (slice * CLUSTER_COUNT_Y + y) * CLUSTER_COUNT_X;
+                for (uint32_t x = bounds.first.x; x <= bounds.last.x; x++) {
+                    ClusterRange &cluster = clusters[row + x];
+                    if (fill) {
+                        lightIndices[cluster.offset + cluster.count] = i;
+                    }
+                    cluster.count++;
+                }
+            }
+        }
+    }
+
+    void LightClusterGrid::writeToUbo(GlobalUbo &ubo) const {
+        ubo.clusterScale = clusterScale;
+        ubo.clusterCounts = {CLUSTER_COUNT_X, CLUSTER_COUNT_Y, CLUSTER_COUNT_Z, static_cast<uint32_t>(lights.size())};
+    }
+
+}  // namespace Ocean
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "frame_info.hpp"
+#include "vulkan/buffer.hpp"
+#include "vulkan/descriptors.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/swap_chain.hpp"
+
+// std
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace Ocean {
+
+    // Clustered forward lighting. The view frustum is split into screen tiles and exponentially
+    // spaced depth slices, every frame each point light is binned into the clusters its range
+    // reaches, so a fragment only evaluates the lights listed for its cluster. Binning runs on the
+    // CPU, one job per depth slice, and assumes a perspective projection.
+    class LightClusterGrid {
+    public:
+        static constexpr uint32_t CLUSTER_COUNT_X = 16;
+        static constexpr uint32_t CLUSTER_COUNT_Y = 9;
+        static constexpr uint32_t CLUSTER_COUNT_Z = 24;
+        static constexpr uint32_t CLUSTER_COUNT = CLUSTER_COUNT_X * CLUSTER_COUNT_Y * CLUSTER_COUNT_Z;
+
+        explicit LightClusterGrid(Device &device);
+
+        LightClusterGrid(const LightClusterGrid &) = delete;
+
+        LightClusterGrid &operator=(const LightClusterGrid &) = delete;
+
+        // gathers the world space lights, bins them and uploads this frame's buffers, runs after
+        // the game object buffer is updated and the shadowed lights are picked. shadowMapInfo is
+        // bound next to the lights, see ShadowSystem::getShadowMapInfo
+        void build(FrameInfo &frameInfo, VkDescriptorImageInfo shadowMapInfo);
+
+        // grid parameters and light count of the last build
+        void writeToUbo(GlobalUbo &ubo) const;
+
+        // set of lit geometry: lights, the light range of every cluster, the light index list and
+        // the point light shadow maps
+        [[nodiscard]] VkDescriptorSetLayout getSetLayout() const { return setLayout->getDescriptorSetLayout(); }
+
+        // valid for the frame of the last build
+        [[nodiscard]] VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+
+        [[nodiscard]] uint32_t getLightCount() const { return static_cast<uint32_t>(lights.size()); }
+
+        // cluster to light references of the last build
+        [[nodiscard]] uint32_t getLightIndexCount() const { return static_cast<uint32_t>(lightIndices.size()); }
+
+    private:
+        // matches ClusterRange in lighting.glsl
+        struct ClusterRange {
+            uint32_t offset;  // into the light index list
+            uint32_t count;
+        };
+
+        // inclusive cluster coordinates a light reaches, empty if first.z > last.z
+        struct LightBounds {
+            glm::uvec3 first;
+            glm::uvec3 last;
+        };
+
+        // computes lightBounds from the view space spheres of the lights
+        void boundLights(FrameInfo &frameInfo);
+
+        // counts (fill == false) or writes (fill == true) the light indices of one depth slice
+        void binSlice(uint32_t slice, bool fill);
+
+        Device &device;
+        std::unique_ptr<DescriptorSetLayout> setLayout;
+        VkDescriptorSet descriptorSet{};
+
+        std::array<std::unique_ptr<OceanBuffer>, SwapChain::MAX_FRAMES_IN_FLIGHT> lightBuffers;
+        std::array<std::unique_ptr<OceanBuffer>, SwapChain::MAX_FRAMES_IN_FLIGHT> clusterBuffers;
+        std::array<std::unique_ptr<OceanBuffer>, SwapChain::MAX_FRAMES_IN_FLIGHT> lightIndexBuffers;
+
+        glm::vec4 clusterScale{};
+        // scratch, kept to reuse their capacity
+        std::vector<PointLight> lights;
+        std::vector<LightBounds> lightBounds;
+        std::vector<ClusterRange> clusters;
+        std::vector<uint32_t> lightIndices;
+    };
+
+}  // namespace Ocean
@@ -6,10 +6,10 @@
 #include <iostream>
 #include <stdexcept>
 
-int main() {
-    Ocean::App app{};
-
+int main(int argc, char **argv) {
     try {
+        // loading the scene throws on a missing or corrupt file
+        Ocean::App app{argc > 1 ? argv[1] : Ocean::App::DEFAULT_SCENE};
         app.run();
     } catch (const std::exception &e) {
         std::cerr << e.what() << '\n';
@@ -0,0 +1,71 @@
+#include "mesh_pool.hpp"
+
+// std
+#include <cassert>
+
+namespace Ocean {
+
+    MeshPool::MeshPool(Device &device) : device{device} {
+        reserve(INITIAL_VERTEX_CAPACITY, INITIAL_INDEX_CAPACITY);
+    }
+
+    uint32_t MeshPool::add(const Model &model) {
+        assert(model.getIndexBuffer() != VK_NULL_HANDLE && "MeshPool only holds indexed models");
+        reserve(vertexCount + model.getVertexCount(), indexCount + model.getIndexCount());
+
+        // indices stay relative to the model, vertexOffset rebases them at draw time
+        device.copyBuffer(
+                model.getVertexBuffer(),
+                vertexBuffer->getBuffer(),
+                VkDeviceSize{model.getVertexCount()} * sizeof(Model::Vertex),
+                0,
+                VkDeviceSize{vertexCount} * sizeof(Model::Vertex));
+        device.copyBuffer(
+                model.getIndexBuffer(),
+                indexBuffer->getBuffer(),
+                VkDeviceSize{model.getIndexCount()} * sizeof(uint32_t),
+                0,
+                VkDeviceSize{indexCount} * sizeof(uint32_t));
+
+        meshes.push_back(Mesh{indexCount, model.getIndexCount(), static_cast<int32_t>(vertexCount)});
+        vertexCount += model.getVertexCount();
+        indexCount += model.getIndexCount();
+        return static_cast<uint32_t>(meshes.size() - 1);
+    }
+
+    void MeshPool::bind(VkCommandBuffer commandBuffer) const {
+        VkBuffer buffers[] = {vertexBuffer->getBuffer()};
+        VkDeviceSize offsets[] = {0};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+        vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    }
+
+    void MeshPool::reserve(uint32_t vertexCapacity, uint32_t indexCapacity) {
+        auto grow = [&](std::unique_ptr<OceanBuffer> &buffer,
+                        VkDeviceSize elementSize,
+                        uint32_t usedCount,
+                        uint32_t requiredCount,
+                        VkBufferUsageFlags usage) {
+            uint32_t capacity = buffer ? buffer->getInstanceCount() : requiredCount;
+            if (buffer && requiredCount <= capacity) return;
+            while (capacity < requiredCount) {
+                capacity *= 2;
+            }
+
+            auto grown = std::make_unique<OceanBuffer>(
+                    device,
+                    elementSize,
+                    capacity,
+                    usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            if (usedCount > 0) {
+                device.copyBuffer(buffer->getBuffer(), grown->getBuffer(), elementSize * usedCount);
+            }
+            // frames in flight may still draw from the old buffer, its destructor defers the free
+            buffer = std::move(grown);
+        };
+        grow(vertexBuffer, sizeof(Model::Vertex), vertexCount, vertexCapacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+        grow(indexBuffer, sizeof(uint32_t), indexCount, indexCapacity, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    }
+
+}  // namespace Ocean
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "model.hpp"
+#include "vulkan/buffer.hpp"
+#include "vulkan/device.hpp"
+
+// std
+#include <memory>
+#include <vector>
+
+namespace Ocean {
+
+    // Vertices and indices of every registered model in one vertex and one index buffer, so all
+    // of them can be drawn after a single bind, e.g. by indirect draws
+    class MeshPool {
+    public:
+        struct Mesh {
+            uint32_t firstIndex;
+            uint32_t indexCount;
+            int32_t vertexOffset;
+        };
+
+        static constexpr uint32_t INITIAL_VERTEX_CAPACITY = 1 << 16;
+        static constexpr uint32_t INITIAL_INDEX_CAPACITY = 1 << 18;
+
+        explicit MeshPool(Device &device);
+
+        MeshPool(const MeshPool &) = delete;
+
+        MeshPool &operator=(const MeshPool &) = delete;
+
+        // uploads the model's staged geometry into the pool, returns its mesh index. The model's
+        // own buffers can be released afterwards
+        uint32_t add(const Model &model);
+
+        [[nodiscard]] const Mesh &getMesh(uint32_t meshIndex) const { return meshes[meshIndex]; }
+
+        [[nodiscard]] uint32_t getMeshCount() const { return static_cast<uint32_t>(meshes.size()); }
+
+        void bind(VkCommandBuffer commandBuffer) const;
+
+    private:
+        void reserve(uint32_t vertexCapacity, uint32_t indexCapacity);
+
+        Device &device;
+        std::unique_ptr<OceanBuffer> vertexBuffer;
+        std::unique_ptr<OceanBuffer> indexBuffer;
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+        std::vector<Mesh> meshes;
+    };
+
+}  // namespace Ocean
@@ -34,6 +34,9 @@ namespace std {
 namespace Ocean {
 
     Model::Model(Device &device, const Model::Builder &builder) : device{device} {
+        for (const auto &vertex: builder.vertices) {
+            bounds.expand(vertex.position);
+        }
         createVertexBuffers(builder.vertices);
         createIndexBuffers(builder.indices);
     }
@@ -50,28 +53,17 @@ namespace Ocean {
     void Model::createVertexBuffers(const std::vector<Vertex> &vertices) {
         vertexCount = static_cast<uint32_t>(vertices.size());
         assert(vertexCount >= 3 && "Vertex count must be at least 3");
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
         uint32_t vertexSize = sizeof(vertices[0]);
 
-        OceanBuffer stagingBuffer{
-                device,
-                vertexSize,
-                vertexCount,
-                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        };
-
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void *) vertices.data());
-
         vertexBuffer = std::make_unique<OceanBuffer>(
                 device,
                 vertexSize,
                 vertexCount,
-                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-        device.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        vertexBuffer->map();
+        vertexBuffer->writeToBuffer((void *) vertices.data());
+        vertexBuffer->unmap();
     }
 
     void Model::createIndexBuffers(const std::vector<uint32_t> &indices) {
@@ -82,46 +74,22 @@ namespace Ocean {
             return;
         }
 
-        VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
         uint32_t indexSize = sizeof(indices[0]);
 
-        OceanBuffer stagingBuffer{
-                device,
-                indexSize,
-                indexCount,
-                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        };
-
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void *) indices.data());
-
         indexBuffer = std::make_unique<OceanBuffer>(
                 device,
                 indexSize,
                 indexCount,
-                VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-        device.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
-    }
-
-    void Model::draw(VkCommandBuffer commandBuffer) const {
-        if (hasIndexBuffer) {
-            vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
-        } else {
-            vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
-        }
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        indexBuffer->map();
+        indexBuffer->writeToBuffer((void *) indices.data());
+        indexBuffer->unmap();
     }
 
-    void Model::bind(VkCommandBuffer commandBuffer) {
-        VkBuffer buffers[] = {vertexBuffer->getBuffer()};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-
-        if (hasIndexBuffer) {
-            vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
-        }
+    void Model::releaseBuffers() {
+        vertexBuffer.reset();
+        indexBuffer.reset();
     }
 
     std::vector<VkVertexInputBindingDescription> Model::Vertex::getBindingDescriptions() {
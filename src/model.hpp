@@ -1,5 +1,6 @@
 #pragma once
 
+#include "geometry.hpp"
 #include "vulkan/buffer.hpp"
 #include "vulkan/device.hpp"
 
@@ -10,6 +11,7 @@
 #include <glm/glm.hpp>
 
 // std
+#include <cassert>
 #include <memory>
 #include <vector>
 
@@ -50,9 +52,27 @@ namespace Ocean {
         static std::unique_ptr<Model> createModelFromFile(
                 Device &device, const std::string &filepath);
 
-        void bind(VkCommandBuffer commandBuffer);
+        // object space bounds of every vertex position
+        [[nodiscard]] const AABB &getBounds() const { return bounds; }
 
-        void draw(VkCommandBuffer commandBuffer) const;
+        // host visible staging buffers, a MeshPool uploads the model from these. Only valid until
+        // releaseBuffers, models are drawn from the pool
+        [[nodiscard]] VkBuffer getVertexBuffer() const {
+            assert(vertexBuffer != nullptr && "Model buffers were released");
+            return vertexBuffer->getBuffer();
+        }
+
+        [[nodiscard]] uint32_t getVertexCount() const { return vertexCount; }
+
+        [[nodiscard]] VkBuffer getIndexBuffer() const {
+            assert((!hasIndexBuffer || indexBuffer != nullptr) && "Model buffers were released");
+            return hasIndexBuffer ? indexBuffer->getBuffer() : VK_NULL_HANDLE;
+        }
+
+        [[nodiscard]] uint32_t getIndexCount() const { return indexCount; }
+
+        // frees the staging buffers once the geometry lives in a MeshPool
+        void releaseBuffers();
 
     private:
         void createVertexBuffers(const std::vector<Vertex> &vertices);
@@ -60,6 +80,7 @@ namespace Ocean {
         void createIndexBuffers(const std::vector<uint32_t> &indices);
 
         Device &device;
+        AABB bounds{};
 
         std::unique_ptr<OceanBuffer> vertexBuffer;
         uint32_t vertexCount{};
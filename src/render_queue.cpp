@@ -0,0 +1,67 @@
+#include "render_queue.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+
+namespace Ocean {
+
+    uint64_t RenderQueue::makeKey(Pass pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float viewDepth) {
+        // GameObjectManager rejects model and texture handles that would not fit, so this runs
+        // per draw without a release build check
+        assert(pipeline < (1u << PIPELINE_BITS) && "Pipeline does not fit in the sort key");
+        assert(material < (1u << MATERIAL_BITS) && "Material does not fit in the sort key");
+        assert(mesh < (1u << MESH_BITS) && "Mesh does not fit in the sort key");
+
+        // non negative floats order like their bit patterns, the top bits keep sign, exponent
+        // and the leading mantissa bits, so precision is relative to the distance
+        uint32_t depthBits;
+        float depth = std::max(viewDepth, 0.f);
+        std::memcpy(&depthBits, &depth, sizeof(depthBits));
+        depthBits >>= 32 - DEPTH_BITS;
+        if (pass == Pass::Transparent) {
+            depthBits = ~depthBits & ((1u << DEPTH_BITS) - 1);
+        }
+
+        uint64_t key = static_cast<uint64_t>(pass);
+        key = key << PIPELINE_BITS | pipeline;
+        key = key << MATERIAL_BITS | material;
+        key = key << MESH_BITS | mesh;
+        key = key << DEPTH_BITS | depthBits;
+        return key;
+    }
+
+    void RenderQueue::sort() {
+        const size_t count = entries.size();
+        if (count < 2) return;
+        scratch.resize(count);
+
+        // all eight histograms in one read over the keys
+        std::array<std::array<uint32_t, 256>, sizeof(uint64_t)> histograms{};
+        for (const auto &entry: entries) {
+            for (uint32_t digit = 0; digit < sizeof(uint64_t); digit++) {
+                histograms[digit][(entry.key >> (8 * digit)) & 0xFF]++;
+            }
+        }
+
+        for (uint32_t digit = 0; digit < sizeof(uint64_t); digit++) {
+            auto &histogram = histograms[digit];
+            if (histogram[(entries[0].key >> (8 * digit)) & 0xFF] == count) continue;
+
+            // counts to starting offsets
+            uint32_t offset = 0;
+            for (auto &bucket: histogram) {
+                uint32_t bucketCount = bucket;
+                bucket = offset;
+                offset += bucketCount;
+            }
+            for (const auto &entry: entries) {
+                scratch[histogram[(entry.key >> (8 * digit)) & 0xFF]++] = entry;
+            }
+            entries.swap(scratch);
+        }
+    }
+
+}  // namespace Ocean
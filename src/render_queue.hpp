@@ -0,0 +1,79 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ocean {
+
+    // Draws keyed by a 64 bit sort key, most significant first:
+    //
+    //   pass (2) | pipeline (6) | material (16) | mesh (16) | depth (24)
+    //
+    // Sorting groups draws by state, so binds only change at group boundaries, and orders draws
+    // sharing all state by depth: front to back for opaque passes so early depth testing rejects
+    // hidden fragments, back to front for transparent passes so blending composes correctly.
+    class RenderQueue {
+    public:
+        enum class Pass : uint32_t {
+            Opaque = 0,
+            Transparent = 1
+        };
+
+        struct Entry {
+            uint64_t key;
+            uint32_t value;  // e.g. an object index
+        };
+
+        static constexpr uint32_t PIPELINE_BITS = 6;
+        static constexpr uint32_t MATERIAL_BITS = 16;
+        static constexpr uint32_t MESH_BITS = 16;
+        static constexpr uint32_t DEPTH_BITS = 24;
+
+        // viewDepth is the distance in front of the camera, negative depths count as 0. pipeline,
+        // material and mesh have to fit in their fields
+        [[nodiscard]] static uint64_t makeKey(
+                Pass pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float viewDepth);
+
+        [[nodiscard]] static Pass passOf(uint64_t key) {
+            return static_cast<Pass>(key >> (PIPELINE_BITS + MATERIAL_BITS + MESH_BITS + DEPTH_BITS));
+        }
+
+        [[nodiscard]] static uint32_t pipelineOf(uint64_t key) {
+            return field(key, MATERIAL_BITS + MESH_BITS + DEPTH_BITS, PIPELINE_BITS);
+        }
+
+        [[nodiscard]] static uint32_t materialOf(uint64_t key) {
+            return field(key, MESH_BITS + DEPTH_BITS, MATERIAL_BITS);
+        }
+
+        [[nodiscard]] static uint32_t meshOf(uint64_t key) { return field(key, DEPTH_BITS, MESH_BITS); }
+
+        // key without the depth, equal for draws that can share one instanced draw
+        [[nodiscard]] static uint64_t stateOf(uint64_t key) { return key >> DEPTH_BITS; }
+
+        void clear() { entries.clear(); }
+
+        void push(uint64_t key, uint32_t value) { entries.push_back(Entry{key, value}); }
+
+        // stable LSD radix sort by key, one byte per pass. Passes where every key has the same
+        // byte are skipped, so unused high bits cost nothing
+        void sort();
+
+        [[nodiscard]] const std::vector<Entry> &getEntries() const { return entries; }
+
+        [[nodiscard]] size_t size() const { return entries.size(); }
+
+        [[nodiscard]] bool empty() const { return entries.empty(); }
+
+    private:
+        [[nodiscard]] static uint32_t field(uint64_t key, uint32_t shift, uint32_t bits) {
+            return static_cast<uint32_t>(key >> shift) & ((1u << bits) - 1);
+        }
+
+        std::vector<Entry> entries;
+        std::vector<Entry> scratch;  // kept to reuse its capacity
+    };
+
+}  // namespace Ocean
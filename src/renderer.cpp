@@ -1,19 +1,23 @@
 #include "renderer.hpp"
 
 // std
-#include <array>
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
 namespace Ocean {
 
-    OceanRenderer::OceanRenderer(Window &window, Device &device)
-            : window{window}, device{device} {
+    OceanRenderer::OceanRenderer(Window &window, Device &device, uint32_t recordingSlots)
+            : window{window}, device{device}, recordingSlotCount{std::max(recordingSlots, 1u)} {
         recreateSwapChain();
         createCommandBuffers();
+        createSecondaryCommandPools();
     }
 
-    OceanRenderer::~OceanRenderer() { freeCommandBuffers(); }
+    OceanRenderer::~OceanRenderer() {
+        destroySecondaryCommandPools();
+        freeCommandBuffers();
+    }
 
     void OceanRenderer::recreateSwapChain() {
         auto extent = window.getExtent();
@@ -22,6 +26,7 @@ namespace Ocean {
             glfwWaitEvents();
         }
         vkDeviceWaitIdle(device.device());
+        device.releaseAllRetiredResources();
 
         if (swapChain == nullptr) {
             swapChain = std::make_unique<SwapChain>(device, extent);
@@ -59,6 +64,90 @@ namespace Ocean {
         commandBuffers.clear();
     }
 
+    void OceanRenderer::createSecondaryCommandPools() {
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = device.findPhysicalQueueFamilies().graphicsFamily;
+        // buffers are rerecorded every frame and reset together with their pool
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        secondaryCommandPools.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+        for (auto &framePools: secondaryCommandPools) {
+            framePools = std::vector<SecondaryCommandPool>(recordingSlotCount);
+            for (auto &slotPool: framePools) {
+                if (vkCreateCommandPool(device.device(), &poolInfo, nullptr, &slotPool.pool) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create secondary command pool!");
+                }
+            }
+        }
+    }
+
+    void OceanRenderer::destroySecondaryCommandPools() {
+        // destroying a pool frees its command buffers
+        for (auto &framePools: secondaryCommandPools) {
+            for (auto &slotPool: framePools) {
+                vkDestroyCommandPool(device.device(), slotPool.pool, nullptr);
+            }
+        }
+        secondaryCommandPools.clear();
+    }
+
+    void OceanRenderer::resetSecondaryCommandPools() {
+        for (auto &slotPool: secondaryCommandPools[currentFrameIndex]) {
+            if (slotPool.usedCount == 0) continue;
+            vkResetCommandPool(device.device(), slotPool.pool, 0);
+            slotPool.usedCount = 0;
+        }
+    }
+
+    VkCommandBuffer OceanRenderer::beginSecondaryCommandBuffer(uint32_t slot) {
+        assert(isFrameStarted && "Can't begin a secondary command buffer if frame is not in progress");
+        assert(slot < recordingSlotCount && "Recording slot out of range");
+
+        auto &slotPool = secondaryCommandPools[currentFrameIndex][slot];
+        if (slotPool.usedCount == slotPool.commandBuffers.size()) {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandPool = slotPool.pool;
+            allocInfo.commandBufferCount = 1;
+
+            VkCommandBuffer commandBuffer;
+            if (vkAllocateCommandBuffers(device.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate secondary command buffer!");
+            }
+            slotPool.commandBuffers.push_back(commandBuffer);
+        }
+        VkCommandBuffer commandBuffer = slotPool.commandBuffers[slotPool.usedCount++];
+
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        assert(currentRenderPass != VK_NULL_HANDLE && "Can't begin a secondary command buffer outside a render pass");
+        inheritanceInfo.renderPass = currentRenderPass;
+        inheritanceInfo.subpass = currentSubpass;
+        inheritanceInfo.framebuffer = currentFramebuffer;
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags =
+                VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording secondary command buffer!");
+        }
+
+        // dynamic state is not inherited from the primary
+        setViewportAndScissor(commandBuffer);
+        return commandBuffer;
+    }
+
+    void OceanRenderer::endSecondaryCommandBuffer(VkCommandBuffer commandBuffer) {
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record secondary command buffer!");
+        }
+    }
+
     VkCommandBuffer OceanRenderer::beginFrame() {
         assert(!isFrameStarted && "Can't call beginFrame while already in progress");
 
@@ -74,6 +163,11 @@ namespace Ocean {
 
         isFrameStarted = true;
 
+        // acquireNextImage waited on this frame's fence, resources retired MAX_FRAMES_IN_FLIGHT
+        // frames ago can no longer be referenced by the GPU
+        device.releaseRetiredResources(frameNumber, SwapChain::MAX_FRAMES_IN_FLIGHT);
+        resetSecondaryCommandPools();
+
         auto commandBuffer = getCurrentCommandBuffer();
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -102,30 +196,91 @@ namespace Ocean {
 
         isFrameStarted = false;
         currentFrameIndex = (currentFrameIndex + 1) % SwapChain::MAX_FRAMES_IN_FLIGHT;
+        frameNumber++;
     }
 
-    void OceanRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+    void OceanRenderer::beginSwapChainRenderPass(
+            VkCommandBuffer commandBuffer, VkSubpassContents contents, SwapChain::RenderPassPhase phase) {
         assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
         assert(
                 commandBuffer == getCurrentCommandBuffer() &&
                 "Can't begin render pass on command buffer from a different frame");
 
+        // ignored by the Second pass, which loads both attachments
+        std::vector<VkClearValue> clearValues(2);
+        clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
+        clearValues[1].depthStencil = {1.0f, 0};
+        beginRenderPass(
+                commandBuffer,
+                swapChain->getRenderPass(phase),
+                swapChain->getFrameBuffer(currentImageIndex),
+                clearValues,
+                contents);
+        // compatible with every phase, so secondary buffers can execute in whichever is current
+        currentRenderPass = swapChain->getRenderPass();
+    }
+
+    void OceanRenderer::beginDeferredRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents) {
+        assert(isFrameStarted && "Can't call beginDeferredRenderPass if frame is not in progress");
+        assert(
+                commandBuffer == getCurrentCommandBuffer() &&
+                "Can't begin render pass on command buffer from a different frame");
+
+        // color, depth, albedo and normal, the lighting subpass skips pixels left at far depth
+        std::vector<VkClearValue> clearValues(4);
+        clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
+        clearValues[1].depthStencil = {1.0f, 0};
+        clearValues[2].color = {0.0f, 0.0f, 0.0f, 0.0f};
+        clearValues[3].color = {0.0f, 0.0f, 0.0f, 0.0f};
+        beginRenderPass(
+                commandBuffer,
+                swapChain->getDeferredRenderPass(),
+                swapChain->getDeferredFrameBuffer(static_cast<int>(currentImageIndex)),
+                clearValues,
+                contents);
+    }
+
+    void OceanRenderer::nextSubpass(VkCommandBuffer commandBuffer, VkSubpassContents contents) {
+        assert(
+                currentRenderPass == swapChain->getDeferredRenderPass() &&
+                currentSubpass < SwapChain::FORWARD_SUBPASS &&
+                "Can't advance past the last subpass of the deferred render pass");
+        vkCmdNextSubpass(commandBuffer, contents);
+        currentSubpass++;
+        if (contents == VK_SUBPASS_CONTENTS_INLINE) {
+            setViewportAndScissor(commandBuffer);
+        }
+    }
+
+    void OceanRenderer::beginRenderPass(
+            VkCommandBuffer commandBuffer,
+            VkRenderPass renderPass,
+            VkFramebuffer framebuffer,
+            const std::vector<VkClearValue> &clearValues,
+            VkSubpassContents contents) {
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = swapChain->getRenderPass();
-        renderPassInfo.framebuffer = swapChain->getFrameBuffer(currentImageIndex);
+        renderPassInfo.renderPass = renderPass;
+        renderPassInfo.framebuffer = framebuffer;
 
         renderPassInfo.renderArea.offset = {0, 0};
         renderPassInfo.renderArea.extent = swapChain->getSwapChainExtent();
 
-        std::array<VkClearValue, 2> clearValues{};
-        clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
-        clearValues[1].depthStencil = {1.0f, 0};
         renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
         renderPassInfo.pClearValues = clearValues.data();
 
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+        currentRenderPass = renderPass;
+        currentFramebuffer = framebuffer;
+        currentSubpass = 0;
+
+        // a pass made of secondary command buffers can't record commands in the primary
+        if (contents == VK_SUBPASS_CONTENTS_INLINE) {
+            setViewportAndScissor(commandBuffer);
+        }
+    }
 
+    void OceanRenderer::setViewportAndScissor(VkCommandBuffer commandBuffer) const {
         VkViewport viewport{};
         viewport.x = 0.0f;
         viewport.y = 0.0f;
@@ -138,12 +293,13 @@ namespace Ocean {
         vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
     }
 
-    void OceanRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) const {
+    void OceanRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
         assert(isFrameStarted && "Can't call endSwapChainRenderPass if frame is not in progress");
         assert(
                 commandBuffer == getCurrentCommandBuffer() &&
                 "Can't end render pass on command buffer from a different frame");
         vkCmdEndRenderPass(commandBuffer);
+        currentRenderPass = VK_NULL_HANDLE;
     }
 
 }  // namespace Ocean
@@ -12,7 +12,9 @@
 namespace Ocean {
     class OceanRenderer {
     public:
-        OceanRenderer(Window &window, Device &device);
+        // recordingSlots is the number of secondary command buffers that can be recorded at the
+        // same time, typically one per job system thread
+        OceanRenderer(Window &window, Device &device, uint32_t recordingSlots = 1);
 
         ~OceanRenderer();
 
@@ -22,8 +24,29 @@ namespace Ocean {
 
         [[nodiscard]] VkRenderPass getSwapChainRenderPass() const { return swapChain->getRenderPass(); }
 
+        [[nodiscard]] VkRenderPass getDeferredRenderPass() const { return swapChain->getDeferredRenderPass(); }
+
         [[nodiscard]] float getAspectRatio() const { return swapChain->extentAspectRatio(); }
 
+        [[nodiscard]] VkExtent2D getSwapChainExtent() const { return swapChain->getSwapChainExtent(); }
+
+        // depth attachment of the image being rendered, sampleable between the First and Second pass
+        [[nodiscard]] VkImageView getCurrentDepthImageView() const {
+            assert(isFrameStarted && "Cannot get depth image view when frame not in progress");
+            return swapChain->getDepthImageView(static_cast<int>(currentImageIndex));
+        }
+
+        // G-buffer attachments of the image being rendered, input attachments of the lighting subpass
+        [[nodiscard]] VkImageView getCurrentAlbedoImageView() const {
+            assert(isFrameStarted && "Cannot get G-buffer image view when frame not in progress");
+            return swapChain->getAlbedoImageView(static_cast<int>(currentImageIndex));
+        }
+
+        [[nodiscard]] VkImageView getCurrentNormalImageView() const {
+            assert(isFrameStarted && "Cannot get G-buffer image view when frame not in progress");
+            return swapChain->getNormalImageView(static_cast<int>(currentImageIndex));
+        }
+
         [[nodiscard]] bool isFrameInProgress() const { return isFrameStarted; }
 
         [[nodiscard]] VkCommandBuffer getCurrentCommandBuffer() const {
@@ -40,24 +63,81 @@ namespace Ocean {
 
         void endFrame();
 
-        void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+        // contents has to be VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS when the pass is
+        // recorded through beginSecondaryCommandBuffer. A frame either begins one Whole pass or a
+        // First pass followed by a Second one
+        void beginSwapChainRenderPass(
+                VkCommandBuffer commandBuffer,
+                VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE,
+                SwapChain::RenderPassPhase phase = SwapChain::RenderPassPhase::Whole);
+
+        // begins the deferred render pass in its G-buffer subpass, the frame's only pass
+        void beginDeferredRenderPass(
+                VkCommandBuffer commandBuffer, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+
+        // advances the deferred render pass to its next subpass
+        void nextSubpass(VkCommandBuffer commandBuffer, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 
-        void endSwapChainRenderPass(VkCommandBuffer commandBuffer) const;
+        // ends either render pass
+        void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
+
+        [[nodiscard]] uint32_t getRecordingSlotCount() const { return recordingSlotCount; }
+
+        // begins a secondary command buffer continuing the current subpass, with viewport and
+        // scissor set. Each slot has its own command pool per frame, so different slots can
+        // record on different threads at the same time, one slot must not be used by two threads
+        // at once. The buffer is valid until this frame index comes around again
+        VkCommandBuffer beginSecondaryCommandBuffer(uint32_t slot);
+
+        static void endSecondaryCommandBuffer(VkCommandBuffer commandBuffer);
 
     private:
+        // padded so slots recorded on different threads don't share cache lines
+        struct alignas(64) SecondaryCommandPool {
+            VkCommandPool pool = VK_NULL_HANDLE;
+            std::vector<VkCommandBuffer> commandBuffers;
+            uint32_t usedCount = 0;  // buffers handed out this frame
+        };
+
         void createCommandBuffers();
 
         void freeCommandBuffers();
 
+        void setViewportAndScissor(VkCommandBuffer commandBuffer) const;
+
+        // shared by both render passes, clearValues holds one value per attachment
+        void beginRenderPass(
+                VkCommandBuffer commandBuffer,
+                VkRenderPass renderPass,
+                VkFramebuffer framebuffer,
+                const std::vector<VkClearValue> &clearValues,
+                VkSubpassContents contents);
+
+        void createSecondaryCommandPools();
+
+        void destroySecondaryCommandPools();
+
+        // resets every pool of the current frame, its fence must have been waited on
+        void resetSecondaryCommandPools();
+
         void recreateSwapChain();
 
         Window &window;
         Device &device;
         std::unique_ptr<SwapChain> swapChain;
         std::vector<VkCommandBuffer> commandBuffers;
+        uint32_t recordingSlotCount;
+        // [frame index][slot]
+        std::vector<std::vector<SecondaryCommandPool>> secondaryCommandPools;
+
+        // inherited by secondary command buffers, a Whole swap chain pass stands in for every phase
+        VkRenderPass currentRenderPass = VK_NULL_HANDLE;
+        VkFramebuffer currentFramebuffer = VK_NULL_HANDLE;
+        uint32_t currentSubpass = 0;
 
         uint32_t currentImageIndex{};
         int currentFrameIndex{0};
+        uint64_t frameNumber{0};  // frames begun so far, drives deferred resource destruction
         bool isFrameStarted{false};
     };
 }  // namespace Ocean
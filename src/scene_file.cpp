@@ -0,0 +1,273 @@
+#include "scene_file.hpp"
+
+// std
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+// platform
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Ocean {
+
+    namespace {
+
+        constexpr size_t sectionIndex(SceneSectionId id) { return static_cast<size_t>(id); }
+
+        uint64_t alignOffset(uint64_t offset) {
+            const uint64_t alignment = SceneFileHeader::SECTION_ALIGNMENT;
+            return (offset + alignment - 1) & ~(alignment - 1);
+        }
+
+    }  // namespace
+
+    void SceneData::validate() const {
+        const uint32_t count = objectCount();
+        if (rotations.size() != count || scales.size() != count || colors.size() != count ||
+            models.size() != count || textures.size() != count || parents.size() != count) {
+            throw std::runtime_error("scene component arrays differ in size");
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            if (models[i] != NO_REFERENCE && models[i] >= modelPaths.size()) {
+                throw std::runtime_error("scene object references a missing model");
+            }
+            if (textures[i] != NO_REFERENCE && textures[i] >= texturePaths.size()) {
+                throw std::runtime_error("scene object references a missing texture");
+            }
+            if (parents[i] != NO_REFERENCE && parents[i] >= i) {
+                throw std::runtime_error("scene object parents must come before their children");
+            }
+        }
+        for (const auto &light: lights) {
+            if (light.objectIndex >= count) {
+                throw std::runtime_error("scene light references a missing object");
+            }
+        }
+    }
+
+    void SceneData::writeToFile(const std::string &filepath) const {
+        validate();
+
+        std::vector<uint32_t> modelOffsets;
+        std::vector<uint32_t> textureOffsets;
+        std::vector<char> strings;
+        auto appendStrings = [&](const std::vector<std::string> &paths, std::vector<uint32_t> &offsets) {
+            for (const auto &path: paths) {
+                offsets.push_back(static_cast<uint32_t>(strings.size()));
+                strings.insert(strings.end(), path.begin(), path.end());
+                strings.push_back('\0');
+            }
+        };
+        appendStrings(modelPaths, modelOffsets);
+        appendStrings(texturePaths, textureOffsets);
+
+        SceneFileHeader header{};
+        header.magic = SceneFileHeader::MAGIC;
+        header.version = SceneFileHeader::VERSION;
+        header.objectCount = objectCount();
+        header.modelCount = static_cast<uint32_t>(modelPaths.size());
+        header.textureCount = static_cast<uint32_t>(texturePaths.size());
+        header.lightCount = static_cast<uint32_t>(lights.size());
+
+        struct Payload {
+            const void *data;
+            uint64_t size;
+        };
+        Payload payloads[sectionIndex(SceneSectionId::Count)] = {
+                {translations.data(), translations.size() * sizeof(glm::vec3)},
+                {rotations.data(), rotations.size() * sizeof(glm::vec3)},
+                {scales.data(), scales.size() * sizeof(glm::vec3)},
+                {colors.data(), colors.size() * sizeof(glm::vec3)},
+                {models.data(), models.size() * sizeof(uint32_t)},
+                {textures.data(), textures.size() * sizeof(uint32_t)},
+                {parents.data(), parents.size() * sizeof(uint32_t)},
+                {lights.data(), lights.size() * sizeof(SceneLight)},
+                {modelOffsets.data(), modelOffsets.size() * sizeof(uint32_t)},
+                {textureOffsets.data(), textureOffsets.size() * sizeof(uint32_t)},
+                {strings.data(), strings.size()}};
+
+        uint64_t offset = alignOffset(sizeof(SceneFileHeader));
+        for (size_t i = 0; i < sectionIndex(SceneSectionId::Count); i++) {
+            header.sections[i] = SceneSection{offset, payloads[i].size};
+            offset = alignOffset(offset + payloads[i].size);
+        }
+
+        std::ofstream file{filepath, std::ios::binary | std::ios::trunc};
+        if (!file) {
+            throw std::runtime_error("failed to open file: " + filepath);
+        }
+        const char padding[SceneFileHeader::SECTION_ALIGNMENT] = {};
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        uint64_t written = sizeof(header);
+        for (size_t i = 0; i < sectionIndex(SceneSectionId::Count); i++) {
+            file.write(padding, static_cast<std::streamsize>(header.sections[i].offset - written));
+            file.write(static_cast<const char *>(payloads[i].data), static_cast<std::streamsize>(payloads[i].size));
+            written = header.sections[i].offset + payloads[i].size;
+        }
+        if (!file) {
+            throw std::runtime_error("failed to write file: " + filepath);
+        }
+    }
+
+#ifdef _WIN32
+    SceneFile::SceneFile(const std::string &filepath) {
+        HANDLE file = CreateFileA(
+                filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("failed to open file: " + filepath);
+        }
+        LARGE_INTEGER fileSize{};
+        if (!GetFileSizeEx(file, &fileSize) ||
+            fileSize.QuadPart < static_cast<LONGLONG>(sizeof(SceneFileHeader))) {
+            CloseHandle(file);
+            throw std::runtime_error("scene file is too small: " + filepath);
+        }
+        size = static_cast<size_t>(fileSize.QuadPart);
+        HANDLE fileMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        void *mapping = fileMapping ? MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        // the view keeps its own references to the mapping and the file
+        if (fileMapping) {
+            CloseHandle(fileMapping);
+        }
+        CloseHandle(file);
+        if (mapping == nullptr) {
+            throw std::runtime_error("failed to map file: " + filepath);
+        }
+        data = static_cast<const std::byte *>(mapping);
+
+        try {
+            validate(filepath);
+        } catch (...) {
+            UnmapViewOfFile(mapping);
+            throw;
+        }
+    }
+
+    SceneFile::~SceneFile() {
+        UnmapViewOfFile(data);
+    }
+#else
+    SceneFile::SceneFile(const std::string &filepath) {
+        int fd = open(filepath.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("failed to open file: " + filepath);
+        }
+        struct stat status{};
+        if (fstat(fd, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(SceneFileHeader))) {
+            close(fd);
+            throw std::runtime_error("scene file is too small: " + filepath);
+        }
+        size = static_cast<size_t>(status.st_size);
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // the mapping keeps its own reference to the file
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("failed to map file: " + filepath);
+        }
+        data = static_cast<const std::byte *>(mapping);
+        // the whole file is consumed front to back right after loading. Advice values are not
+        // flags, each one takes its own call. They are only hints, the mapping works without them
+        (void) madvise(mapping, size, MADV_SEQUENTIAL);
+        (void) madvise(mapping, size, MADV_WILLNEED);
+
+        try {
+            validate(filepath);
+        } catch (...) {
+            munmap(mapping, size);
+            throw;
+        }
+    }
+
+    SceneFile::~SceneFile() {
+        munmap(const_cast<std::byte *>(data), size);
+    }
+#endif
+
+    const char *SceneFile::getModelPath(uint32_t index) const {
+        assert(index < getModelCount() && "Scene model index out of range");
+        return section<char>(SceneSectionId::Strings) + section<uint32_t>(SceneSectionId::ModelPaths)[index];
+    }
+
+    const char *SceneFile::getTexturePath(uint32_t index) const {
+        assert(index < getTextureCount() && "Scene texture index out of range");
+        return section<char>(SceneSectionId::Strings) + section<uint32_t>(SceneSectionId::TexturePaths)[index];
+    }
+
+    void SceneFile::validate(const std::string &filepath) const {
+        const SceneFileHeader &h = header();
+        if (h.magic != SceneFileHeader::MAGIC) {
+            throw std::runtime_error("not a scene file: " + filepath);
+        }
+        if (h.version != SceneFileHeader::VERSION) {
+            throw std::runtime_error("unsupported scene file version: " + filepath);
+        }
+
+        // every section has to be aligned, in bounds and exactly as large as its element count says
+        const uint64_t objectCount = h.objectCount;
+        const uint64_t expectedSizes[sectionIndex(SceneSectionId::Count)] = {
+                objectCount * sizeof(glm::vec3),
+                objectCount * sizeof(glm::vec3),
+                objectCount * sizeof(glm::vec3),
+                objectCount * sizeof(glm::vec3),
+                objectCount * sizeof(uint32_t),
+                objectCount * sizeof(uint32_t),
+                objectCount * sizeof(uint32_t),
+                uint64_t{h.lightCount} * sizeof(SceneLight),
+                uint64_t{h.modelCount} * sizeof(uint32_t),
+                uint64_t{h.textureCount} * sizeof(uint32_t),
+                h.sections[sectionIndex(SceneSectionId::Strings)].size};
+        for (size_t i = 0; i < sectionIndex(SceneSectionId::Count); i++) {
+            const SceneSection &section = h.sections[i];
+            if (section.offset % SceneFileHeader::SECTION_ALIGNMENT != 0 || section.size != expectedSizes[i] ||
+                section.offset > size || section.size > size - section.offset) {
+                throw std::runtime_error("corrupt scene file section: " + filepath);
+            }
+        }
+
+        // indices are trusted by the loader, check them once here
+        const uint32_t *models = getModels();
+        const uint32_t *textures = getTextures();
+        const uint32_t *parents = getParents();
+        for (uint32_t i = 0; i < h.objectCount; i++) {
+            if ((models[i] != NO_REFERENCE && models[i] >= h.modelCount) ||
+                (textures[i] != NO_REFERENCE && textures[i] >= h.textureCount) ||
+                (parents[i] != NO_REFERENCE && parents[i] >= i)) {
+                throw std::runtime_error("corrupt scene file references: " + filepath);
+            }
+        }
+        const SceneLight *lights = getLights();
+        for (uint32_t i = 0; i < h.lightCount; i++) {
+            if (lights[i].objectIndex >= h.objectCount) {
+                throw std::runtime_error("corrupt scene file lights: " + filepath);
+            }
+        }
+
+        // strings must be terminated inside the string table
+        const uint64_t stringsSize = h.sections[sectionIndex(SceneSectionId::Strings)].size;
+        const char *strings = section<char>(SceneSectionId::Strings);
+        auto checkPaths = [&](SceneSectionId id, uint32_t count) {
+            const uint32_t *offsets = section<uint32_t>(id);
+            for (uint32_t i = 0; i < count; i++) {
+                if (offsets[i] >= stringsSize ||
+                    std::memchr(strings + offsets[i], '\0', stringsSize - offsets[i]) == nullptr) {
+                    throw std::runtime_error("corrupt scene file strings: " + filepath);
+                }
+            }
+        };
+        checkPaths(SceneSectionId::ModelPaths, h.modelCount);
+        checkPaths(SceneSectionId::TexturePaths, h.textureCount);
+    }
+
+}  // namespace Ocean
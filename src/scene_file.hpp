@@ -0,0 +1,139 @@
+#pragma once
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Ocean {
+
+    // Binary scene (.oscene) layout. The file starts with a SceneFileHeader followed by the
+    // sections it lists. Sections are 16 byte aligned, little endian and hold one array per
+    // component in scene object order, so they can be copied straight into GameObjectStorage.
+    enum class SceneSectionId : uint32_t {
+        Translations,  // glm::vec3[objectCount]
+        Rotations,     // glm::vec3[objectCount]
+        Scales,        // glm::vec3[objectCount]
+        Colors,        // glm::vec3[objectCount]
+        Models,        // uint32_t[objectCount], index into the model paths or NO_REFERENCE
+        Textures,      // uint32_t[objectCount], index into the texture paths or NO_REFERENCE
+        Parents,       // uint32_t[objectCount], index of an earlier object or NO_REFERENCE
+        Lights,        // SceneLight[lightCount]
+        ModelPaths,    // uint32_t[modelCount], offsets into Strings
+        TexturePaths,  // uint32_t[textureCount], offsets into Strings
+        Strings,       // null terminated utf-8 strings
+        Count
+    };
+
+    struct SceneSection {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    struct SceneLight {
+        uint32_t objectIndex;
+        float intensity;
+    };
+
+    struct SceneFileHeader {
+        static constexpr uint32_t MAGIC = 0x4E43534F;  // "OSCN"
+        static constexpr uint32_t VERSION = 1;
+        static constexpr uint64_t SECTION_ALIGNMENT = 16;
+
+        uint32_t magic;
+        uint32_t version;
+        uint32_t objectCount;
+        uint32_t modelCount;
+        uint32_t textureCount;
+        uint32_t lightCount;
+        SceneSection sections[static_cast<size_t>(SceneSectionId::Count)];
+    };
+
+    static_assert(sizeof(glm::vec3) == 12, "scene files store tightly packed vec3s");
+
+    // In memory scene, used to build binary scenes
+    struct SceneData {
+        static constexpr uint32_t NO_REFERENCE = ~0u;
+
+        std::vector<glm::vec3> translations;
+        std::vector<glm::vec3> rotations;
+        std::vector<glm::vec3> scales;
+        std::vector<glm::vec3> colors;
+        std::vector<uint32_t> models;
+        std::vector<uint32_t> textures;
+        std::vector<uint32_t> parents;
+        std::vector<SceneLight> lights;
+        std::vector<std::string> modelPaths;
+        std::vector<std::string> texturePaths;
+
+        [[nodiscard]] uint32_t objectCount() const { return static_cast<uint32_t>(translations.size()); }
+
+        // throws if the arrays disagree in size or references are out of range
+        void validate() const;
+
+        void writeToFile(const std::string &filepath) const;
+    };
+
+    // Read only view of a binary scene mapped into memory. The file is validated once when opened,
+    // the accessors then point directly into the mapping.
+    class SceneFile {
+    public:
+        static constexpr uint32_t NO_REFERENCE = SceneData::NO_REFERENCE;
+
+        explicit SceneFile(const std::string &filepath);
+
+        ~SceneFile();
+
+        SceneFile(const SceneFile &) = delete;
+
+        SceneFile &operator=(const SceneFile &) = delete;
+
+        [[nodiscard]] uint32_t getObjectCount() const { return header().objectCount; }
+
+        [[nodiscard]] uint32_t getModelCount() const { return header().modelCount; }
+
+        [[nodiscard]] uint32_t getTextureCount() const { return header().textureCount; }
+
+        [[nodiscard]] uint32_t getLightCount() const { return header().lightCount; }
+
+        [[nodiscard]] const glm::vec3 *getTranslations() const { return section<glm::vec3>(SceneSectionId::Translations); }
+
+        [[nodiscard]] const glm::vec3 *getRotations() const { return section<glm::vec3>(SceneSectionId::Rotations); }
+
+        [[nodiscard]] const glm::vec3 *getScales() const { return section<glm::vec3>(SceneSectionId::Scales); }
+
+        [[nodiscard]] const glm::vec3 *getColors() const { return section<glm::vec3>(SceneSectionId::Colors); }
+
+        [[nodiscard]] const uint32_t *getModels() const { return section<uint32_t>(SceneSectionId::Models); }
+
+        [[nodiscard]] const uint32_t *getTextures() const { return section<uint32_t>(SceneSectionId::Textures); }
+
+        [[nodiscard]] const uint32_t *getParents() const { return section<uint32_t>(SceneSectionId::Parents); }
+
+        [[nodiscard]] const SceneLight *getLights() const { return section<SceneLight>(SceneSectionId::Lights); }
+
+        [[nodiscard]] const char *getModelPath(uint32_t index) const;
+
+        [[nodiscard]] const char *getTexturePath(uint32_t index) const;
+
+    private:
+        [[nodiscard]] const SceneFileHeader &header() const {
+            return *reinterpret_cast<const SceneFileHeader *>(data);
+        }
+
+        template<typename T>
+        [[nodiscard]] const T *section(SceneSectionId id) const {
+            return reinterpret_cast<const T *>(data + header().sections[static_cast<size_t>(id)].offset);
+        }
+
+        void validate(const std::string &filepath) const;
+
+        const std::byte *data = nullptr;
+        size_t size = 0;
+    };
+
+}  // namespace Ocean
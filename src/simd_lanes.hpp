@@ -0,0 +1,195 @@
+#pragma once
+
+// Lane types for the SIMD kernels, picked from the widest instruction set the including
+// translation unit is compiled for. OCEAN_SIMD_SCALAR_ONLY is defined when there is none.
+
+// std
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace Ocean {
+
+    // Each backend exposes the same handful of lane-wise operations so kernels are written once
+    // as templates over the lane type. F holds one float per object, I one int32 per object.
+#if defined(__AVX2__)
+    struct SimdLanes {
+        static constexpr int width = 8;
+        static constexpr const char *name = "AVX2";
+        using F = __m256;
+        using I = __m256i;
+
+        static F set1(float v) { return _mm256_set1_ps(v); }
+
+        static F load(const float *p) { return _mm256_load_ps(p); }
+
+        static void store(float *p, F v) { _mm256_store_ps(p, v); }
+
+        static F loadUnaligned(const float *p) { return _mm256_loadu_ps(p); }
+
+        static F min(F a, F b) { return _mm256_min_ps(a, b); }
+
+        // bit i set if lane i is below zero
+        static int negativeMask(F v) {
+            return _mm256_movemask_ps(_mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+
+        static F add(F a, F b) { return _mm256_add_ps(a, b); }
+
+        static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+
+        static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+
+        static F div(F a, F b) { return _mm256_div_ps(a, b); }
+
+        static F negate(F v) { return _mm256_xor_ps(v, _mm256_set1_ps(-0.f)); }
+
+        static I roundToInt(F v) { return _mm256_cvtps_epi32(v); }
+
+        static F toFloat(I v) { return _mm256_cvtepi32_ps(v); }
+
+        static I addInt(I v, int32_t k) { return _mm256_add_epi32(v, _mm256_set1_epi32(k)); }
+
+        // lane-wise (v & bit) ? ifSet : ifClear
+        static F selectBit(I v, int32_t bit, F ifClear, F ifSet) {
+            __m256i bits = _mm256_set1_epi32(bit);
+            __m256i mask = _mm256_cmpeq_epi32(_mm256_and_si256(v, bits), bits);
+            return _mm256_blendv_ps(ifClear, ifSet, _mm256_castsi256_ps(mask));
+        }
+    };
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    struct SimdLanes {
+        static constexpr int width = 4;
+        static constexpr const char *name = "SSE2";
+        using F = __m128;
+        using I = __m128i;
+
+        static F set1(float v) { return _mm_set1_ps(v); }
+
+        static F load(const float *p) { return _mm_load_ps(p); }
+
+        static void store(float *p, F v) { _mm_store_ps(p, v); }
+
+        static F loadUnaligned(const float *p) { return _mm_loadu_ps(p); }
+
+        static F min(F a, F b) { return _mm_min_ps(a, b); }
+
+        // bit i set if lane i is below zero
+        static int negativeMask(F v) { return _mm_movemask_ps(_mm_cmplt_ps(v, _mm_setzero_ps())); }
+
+        static F add(F a, F b) { return _mm_add_ps(a, b); }
+
+        static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+
+        static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+
+        static F div(F a, F b) { return _mm_div_ps(a, b); }
+
+        static F negate(F v) { return _mm_xor_ps(v, _mm_set1_ps(-0.f)); }
+
+        static I roundToInt(F v) { return _mm_cvtps_epi32(v); }
+
+        static F toFloat(I v) { return _mm_cvtepi32_ps(v); }
+
+        static I addInt(I v, int32_t k) { return _mm_add_epi32(v, _mm_set1_epi32(k)); }
+
+        // lane-wise (v & bit) ? ifSet : ifClear
+        static F selectBit(I v, int32_t bit, F ifClear, F ifSet) {
+            __m128i bits = _mm_set1_epi32(bit);
+            __m128 mask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(v, bits), bits));
+            return _mm_or_ps(_mm_and_ps(mask, ifSet), _mm_andnot_ps(mask, ifClear));
+        }
+    };
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    struct SimdLanes {
+        static constexpr int width = 4;
+        static constexpr const char *name = "NEON";
+        using F = float32x4_t;
+        using I = int32x4_t;
+
+        static F set1(float v) { return vdupq_n_f32(v); }
+
+        static F load(const float *p) { return vld1q_f32(p); }
+
+        static void store(float *p, F v) { vst1q_f32(p, v); }
+
+        static F loadUnaligned(const float *p) { return vld1q_f32(p); }
+
+        static F min(F a, F b) { return vminq_f32(a, b); }
+
+        // bit i set if lane i is below zero
+        static int negativeMask(F v) {
+            const uint32_t laneBits[4] = {1, 2, 4, 8};
+            return static_cast<int>(vaddvq_u32(vandq_u32(vcltzq_f32(v), vld1q_u32(laneBits))));
+        }
+
+        static F add(F a, F b) { return vaddq_f32(a, b); }
+
+        static F sub(F a, F b) { return vsubq_f32(a, b); }
+
+        static F mul(F a, F b) { return vmulq_f32(a, b); }
+
+        static F div(F a, F b) { return vdivq_f32(a, b); }
+
+        static F negate(F v) { return vnegq_f32(v); }
+
+        static I roundToInt(F v) { return vcvtnq_s32_f32(v); }
+
+        static F toFloat(I v) { return vcvtq_f32_s32(v); }
+
+        static I addInt(I v, int32_t k) { return vaddq_s32(v, vdupq_n_s32(k)); }
+
+        // lane-wise (v & bit) ? ifSet : ifClear
+        static F selectBit(I v, int32_t bit, F ifClear, F ifSet) {
+            return vbslq_f32(vtstq_s32(v, vdupq_n_s32(bit)), ifSet, ifClear);
+        }
+    };
+#else
+#define OCEAN_SIMD_SCALAR_ONLY
+#endif
+
+    struct ScalarLanes {
+        static constexpr int width = 1;
+        static constexpr const char *name = "scalar";
+        using F = float;
+        using I = int32_t;
+
+        static F set1(float v) { return v; }
+
+        static F load(const float *p) { return *p; }
+
+        static void store(float *p, F v) { *p = v; }
+
+        static F loadUnaligned(const float *p) { return *p; }
+
+        static F min(F a, F b) { return a < b ? a : b; }
+
+        static int negativeMask(F v) { return v < 0.f ? 1 : 0; }
+
+        static F add(F a, F b) { return a + b; }
+
+        static F sub(F a, F b) { return a - b; }
+
+        static F mul(F a, F b) { return a * b; }
+
+        static F div(F a, F b) { return a / b; }
+
+        static F negate(F v) { return -v; }
+
+        static I roundToInt(F v) { return static_cast<I>(std::lrint(v)); }
+
+        static F toFloat(I v) { return static_cast<F>(v); }
+
+        static I addInt(I v, int32_t k) { return v + k; }
+
+        static F selectBit(I v, int32_t bit, F ifClear, F ifSet) { return (v & bit) ? ifSet : ifClear; }
+    };
+
+}  // namespace Ocean
@@ -0,0 +1,48 @@
+#pragma once
+
+// std
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace Ocean {
+
+    // Maps sparse integer keys to dense array indices in O(1) without hashing. The owner keeps
+    // the dense arrays, this only tracks where each key currently lives.
+    class SparseSet {
+    public:
+        static constexpr uint32_t INVALID_INDEX = ~0u;
+
+        [[nodiscard]] bool contains(uint32_t key) const {
+            return key < sparse.size() && sparse[key] != INVALID_INDEX;
+        }
+
+        [[nodiscard]] uint32_t indexOf(uint32_t key) const {
+            assert(contains(key) && "Key is not in sparse set");
+            return sparse[key];
+        }
+
+        void insert(uint32_t key, uint32_t denseIndex) {
+            if (key >= sparse.size()) {
+                sparse.resize(key + 1, INVALID_INDEX);
+            }
+            assert(sparse[key] == INVALID_INDEX && "Key already in sparse set");
+            sparse[key] = denseIndex;
+        }
+
+        // re-point a key after its dense entry was moved
+        void update(uint32_t key, uint32_t denseIndex) {
+            assert(contains(key) && "Key is not in sparse set");
+            sparse[key] = denseIndex;
+        }
+
+        void erase(uint32_t key) {
+            assert(contains(key) && "Key is not in sparse set");
+            sparse[key] = INVALID_INDEX;
+        }
+
+    private:
+        std::vector<uint32_t> sparse;
+    };
+
+}  // namespace Ocean
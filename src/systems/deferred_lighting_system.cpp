@@ -0,0 +1,111 @@
+#include "deferred_lighting_system.hpp"
+
+// std
+#include <array>
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+
+namespace Ocean {
+
+    DeferredLightingSystem::DeferredLightingSystem(
+            Device &device,
+            VkRenderPass deferredRenderPass,
+            VkDescriptorSetLayout globalSetLayout,
+            VkDescriptorSetLayout lightSetLayout)
+            : device{device} {
+        createPipelineLayout(globalSetLayout, lightSetLayout);
+        createPipeline(deferredRenderPass);
+    }
+
+    DeferredLightingSystem::~DeferredLightingSystem() {
+        vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+    }
+
+    void DeferredLightingSystem::createPipelineLayout(
+            VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout lightSetLayout) {
+        gBufferSetLayout =
+                DescriptorSetLayout::Builder(device)
+                        .addBinding(0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+                        .addBinding(1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+                        .addBinding(2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+                        .build();
+
+        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
+                globalSetLayout,
+                gBufferSetLayout->getDescriptorSetLayout(),
+                lightSetLayout};
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = 0;
+        pipelineLayoutInfo.pPushConstantRanges = nullptr;
+        if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
+    }
+
+    void DeferredLightingSystem::createPipeline(VkRenderPass deferredRenderPass) {
+        assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+        // the subpass has no depth attachment, pixels without geometry are discarded by depth
+        PipelineConfigInfo pipelineConfig{};
+        Pipeline::defaultPipelineConfigInfo(pipelineConfig);
+        pipelineConfig.attributeDescriptions.clear();
+        pipelineConfig.bindingDescriptions.clear();
+        pipelineConfig.rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
+        pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+        pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+        pipelineConfig.renderPass = deferredRenderPass;
+        pipelineConfig.subpass = SwapChain::LIGHTING_SUBPASS;
+        pipelineConfig.pipelineLayout = pipelineLayout;
+        pipeline = std::make_unique<Pipeline>(
+                device,
+                "shaders/deferred_lighting.vert.spv",
+                "shaders/deferred_lighting.frag.spv",
+                pipelineConfig);
+    }
+
+    void DeferredLightingSystem::render(FrameInfo &frameInfo) {
+        auto &renderer = frameInfo.renderer;
+
+        // input attachments are read in the layout of the subpass, without a sampler
+        std::array<VkDescriptorImageInfo, 3> gBufferInfos{};
+        gBufferInfos[0].imageView = renderer.getCurrentAlbedoImageView();
+        gBufferInfos[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        gBufferInfos[1].imageView = renderer.getCurrentNormalImageView();
+        gBufferInfos[1].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        gBufferInfos[2].imageView = renderer.getCurrentDepthImageView();
+        gBufferInfos[2].imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        VkDescriptorSet gBufferDescriptorSet;
+        DescriptorWriter(*gBufferSetLayout, frameInfo.descriptorCache)
+                .writeImage(0, &gBufferInfos[0])
+                .writeImage(1, &gBufferInfos[1])
+                .writeImage(2, &gBufferInfos[2])
+                .build(gBufferDescriptorSet);
+
+        std::array<VkDescriptorSet, 3> descriptorSets{
+                frameInfo.globalDescriptorSet,
+                gBufferDescriptorSet,
+                frameInfo.lightDescriptorSet};
+
+        VkCommandBuffer commandBuffer = renderer.beginSecondaryCommandBuffer(0);
+        pipeline->bind(commandBuffer);
+        vkCmdBindDescriptorSets(
+                commandBuffer,
+                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                pipelineLayout,
+                0,
+                static_cast<uint32_t>(descriptorSets.size()),
+                descriptorSets.data(),
+                0,
+                nullptr);
+        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        OceanRenderer::endSecondaryCommandBuffer(commandBuffer);
+        vkCmdExecuteCommands(frameInfo.commandBuffer, 1, &commandBuffer);
+    }
+
+}  // namespace Ocean
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "vulkan/device.hpp"
+#include "frame_info.hpp"
+#include "vulkan/descriptors.hpp"
+#include "vulkan/pipeline.hpp"
+
+// std
+#include <memory>
+
+namespace Ocean {
+    // Lighting subpass of the deferred render pass: one fullscreen triangle reads albedo, normal
+    // and depth of its own pixel as input attachments and shades it with the lights of its cluster
+    class DeferredLightingSystem {
+    public:
+        // lightSetLayout is the layout of the light clusters, bound as set 2
+        DeferredLightingSystem(
+                Device &device,
+                VkRenderPass deferredRenderPass,
+                VkDescriptorSetLayout globalSetLayout,
+                VkDescriptorSetLayout lightSetLayout);
+
+        ~DeferredLightingSystem();
+
+        DeferredLightingSystem(const DeferredLightingSystem &) = delete;
+
+        DeferredLightingSystem &operator=(const DeferredLightingSystem &) = delete;
+
+        // called in SwapChain::LIGHTING_SUBPASS, recorded through a secondary command buffer
+        void render(FrameInfo &frameInfo);
+
+    private:
+        void createPipelineLayout(VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout lightSetLayout);
+
+        void createPipeline(VkRenderPass deferredRenderPass);
+
+        Device &device;
+
+        std::unique_ptr<Pipeline> pipeline;
+        VkPipelineLayout pipelineLayout{};
+
+        // set 1, the G-buffer of the image being rendered
+        std::unique_ptr<DescriptorSetLayout> gBufferSetLayout;
+    };
+}  // namespace Ocean
@@ -10,22 +10,24 @@
 // std
 #include <array>
 #include <cassert>
-#include <map>
 #include <stdexcept>
 
 namespace Ocean {
 
-    struct PointLightPushConstants {
-        glm::vec4 position{};
-        glm::vec4 color{};
-        float radius;
+    // matches LightData in point_light.vert
+    struct PointLightData {
+        glm::vec4 position{};  // w is the billboard radius
+        glm::vec4 color{};  // w is intensity
     };
 
     PointLightSystem::PointLightSystem(
-            Device &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
+            Device &device,
+            VkRenderPass renderPass,
+            VkRenderPass deferredRenderPass,
+            VkDescriptorSetLayout globalSetLayout)
             : oceanDevice{device} {
         createPipelineLayout(globalSetLayout);
-        createPipeline(renderPass);
+        createPipelines(renderPass, deferredRenderPass);
     }
 
     PointLightSystem::~PointLightSystem() {
@@ -33,26 +35,28 @@ namespace Ocean {
     }
 
     void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(PointLightPushConstants);
+        lightSetLayout =
+                DescriptorSetLayout::Builder(oceanDevice)
+                        .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                        .build();
 
-        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
+        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
+                globalSetLayout,
+                lightSetLayout->getDescriptorSetLayout()};
 
         VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
         pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        pipelineLayoutInfo.pushConstantRangeCount = 0;
+        pipelineLayoutInfo.pPushConstantRanges = nullptr;
         if (vkCreatePipelineLayout(oceanDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
             VK_SUCCESS) {
             throw std::runtime_error("failed to create pipeline layout!");
         }
     }
 
-    void PointLightSystem::createPipeline(VkRenderPass renderPass) {
+    void PointLightSystem::createPipelines(VkRenderPass renderPass, VkRenderPass deferredRenderPass) {
         assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
         PipelineConfigInfo pipelineConfig{};
@@ -67,73 +71,93 @@ namespace Ocean {
                 "shaders/point_light.vert.spv",
                 "shaders/point_light.frag.spv",
                 pipelineConfig);
+
+        // the forward subpass holds depth read only, the billboards are sorted instead
+        pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+        pipelineConfig.renderPass = deferredRenderPass;
+        pipelineConfig.subpass = SwapChain::FORWARD_SUBPASS;
+        deferredPipeline = std::make_unique<Pipeline>(
+                oceanDevice,
+                "shaders/point_light.vert.spv",
+                "shaders/point_light.frag.spv",
+                pipelineConfig);
     }
 
-    void PointLightSystem::update(FrameInfo &frameInfo, GlobalUbo &ubo) {
+    void PointLightSystem::update(FrameInfo &frameInfo) {
         auto rotateLight = glm::rotate(glm::mat4(1.f), 0.5f * frameInfo.frameTime, {0.f, -1.f, 0.f});
-        int lightIndex = 0;
-        for (auto &kv: frameInfo.gameObjects) {
-            auto &obj = kv.second;
-            if (obj.pointLight == nullptr) continue;
+        auto &manager = frameInfo.gameObjectManager;
+        auto &objects = manager.objects;
+        auto &pointLights = manager.pointLights;
 
-            assert(lightIndex < MAX_LIGHTS && "Point lights exceed maximum specified");
+        for (uint32_t lightIndex = 0; lightIndex < pointLights.size(); lightIndex++) {
+            uint32_t objIndex = pointLights.objectIndices[lightIndex];
+            auto &translation = objects.translations[objIndex];
 
             // update light position
-            obj.transform.translation = glm::vec3(rotateLight * glm::vec4(obj.transform.translation, 1.f));
-
-            // copy light to ubo
-            ubo.pointLights[lightIndex].position = glm::vec4(obj.transform.translation, 1.f);
-            ubo.pointLights[lightIndex].color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
-
-            lightIndex += 1;
+            translation = glm::vec3(rotateLight * glm::vec4(translation, 1.f));
+            manager.markTransformDirty(objIndex);
         }
-        ubo.numLights = lightIndex;
     }
 
     void PointLightSystem::render(FrameInfo &frameInfo) {
-        // sort lights
-        std::map<float, GameObject::id_t> sorted;
-        for (auto &kv: frameInfo.gameObjects) {
-            auto &obj = kv.second;
-            if (obj.pointLight == nullptr) continue;
-
-            // calculate distance
-            auto offset = frameInfo.camera.getPosition() - obj.transform.translation;
-            float disSquared = glm::dot(offset, offset);
-            sorted[disSquared] = obj.getId();
+        auto &manager = frameInfo.gameObjectManager;
+        auto &objects = manager.objects;
+        auto &pointLights = manager.pointLights;
+        if (pointLights.size() == 0) return;
+
+        // back to front by squared camera distance, the transparent pass inverts the distance
+        // bits. Lights at equal distances are all kept, the queue reuses its capacity
+        const glm::vec3 cameraPosition = frameInfo.camera.getPosition();
+        renderQueue.clear();
+        for (uint32_t lightIndex = 0; lightIndex < pointLights.size(); lightIndex++) {
+            auto offset = cameraPosition - manager.worldTranslation(pointLights.objectIndices[lightIndex]);
+            renderQueue.push(
+                    RenderQueue::makeKey(RenderQueue::Pass::Transparent, 0, 0, 0, glm::dot(offset, offset)),
+                    lightIndex);
+        }
+        renderQueue.sort();
+
+        // instance i reads element i
+        const auto lightCount = static_cast<uint32_t>(renderQueue.size());
+        auto &lightBuffer = lightBuffers[frameInfo.frameIndex];
+        OceanBuffer::reserve(
+                oceanDevice, lightBuffer, sizeof(PointLightData), lightCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        auto *lightData = static_cast<PointLightData *>(lightBuffer->getMappedMemory());
+        for (const auto &entry: renderQueue.getEntries()) {
+            uint32_t objIndex = pointLights.objectIndices[entry.value];
+            lightData->position = glm::vec4(manager.worldTranslation(objIndex), manager.worldScale(objIndex));
+            lightData->color = glm::vec4(objects.colors[objIndex], pointLights.lights[entry.value].lightIntensity);
+            lightData++;
+        }
+        lightBuffer->flush();
+
+        auto lightBufferInfo = lightBuffer->descriptorInfo();
+        VkDescriptorSet lightDescriptorSet;
+        DescriptorWriter(*lightSetLayout, frameInfo.descriptorCache)
+                .writeBuffer(0, &lightBufferInfo)
+                .build(lightDescriptorSet);
+        std::array<VkDescriptorSet, 2> descriptorSets{frameInfo.globalDescriptorSet, lightDescriptorSet};
+
+        // the render pass is recorded through secondary command buffers
+        VkCommandBuffer commandBuffer = frameInfo.renderer.beginSecondaryCommandBuffer(0);
+        if (frameInfo.shadingPath == ShadingPath::Deferred) {
+            deferredPipeline->bind(commandBuffer);
+        } else {
+            pipeline->bind(commandBuffer);
         }
-
-        pipeline->bind(frameInfo.commandBuffer);
-
         vkCmdBindDescriptorSets(
-                frameInfo.commandBuffer,
+                commandBuffer,
                 VK_PIPELINE_BIND_POINT_GRAPHICS,
                 pipelineLayout,
                 0,
-                1,
-                &frameInfo.globalDescriptorSet,
+                static_cast<uint32_t>(descriptorSets.size()),
+                descriptorSets.data(),
                 0,
                 nullptr);
-
-        // iterate through sorted lights in reverse order
-        for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
-            // use game obj id to find light object
-            auto &obj = frameInfo.gameObjects.at(it->second);
-
-            PointLightPushConstants push{};
-            push.position = glm::vec4(obj.transform.translation, 1.f);
-            push.color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
-            push.radius = obj.transform.scale.x;
-
-            vkCmdPushConstants(
-                    frameInfo.commandBuffer,
-                    pipelineLayout,
-                    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                    0,
-                    sizeof(PointLightPushConstants),
-                    &push);
-            vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
-        }
+        // one quad per light, instances are drawn in order so blending stays back to front
+        vkCmdDraw(commandBuffer, 6, lightCount, 0, 0);
+        OceanRenderer::endSecondaryCommandBuffer(commandBuffer);
+        vkCmdExecuteCommands(frameInfo.commandBuffer, 1, &commandBuffer);
     }
 
 }  // namespace Ocean
@@ -4,17 +4,26 @@
 #include "vulkan/device.hpp"
 #include "frame_info.hpp"
 #include "game_object.hpp"
+#include "render_queue.hpp"
+#include "vulkan/buffer.hpp"
+#include "vulkan/descriptors.hpp"
 #include "vulkan/pipeline.hpp"
+#include "vulkan/swap_chain.hpp"
 
 // std
+#include <array>
 #include <memory>
 #include <vector>
 
 namespace Ocean {
     class PointLightSystem {
     public:
+        // deferred frames draw the billboards in the forward subpass of deferredRenderPass
         PointLightSystem(
-                Device &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+                Device &device,
+                VkRenderPass renderPass,
+                VkRenderPass deferredRenderPass,
+                VkDescriptorSetLayout globalSetLayout);
 
         ~PointLightSystem();
 
@@ -22,18 +31,27 @@ namespace Ocean {
 
         PointLightSystem &operator=(const PointLightSystem &) = delete;
 
-        static void update(FrameInfo &frameInfo, GlobalUbo &ubo);
+        // moves the lights, runs before the game object buffer is updated
+        static void update(FrameInfo &frameInfo);
 
         void render(FrameInfo &frameInfo);
 
     private:
         void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
 
-        void createPipeline(VkRenderPass renderPass);
+        void createPipelines(VkRenderPass renderPass, VkRenderPass deferredRenderPass);
 
         Device &oceanDevice;
 
         std::unique_ptr<Pipeline> pipeline;
+        // tests against the G-buffer depth without writing it
+        std::unique_ptr<Pipeline> deferredPipeline;
         VkPipelineLayout pipelineLayout{};
+
+        // set 1, one storage buffer per frame holding every light sorted back to front, grown to
+        // the light count
+        std::unique_ptr<DescriptorSetLayout> lightSetLayout;
+        std::array<std::unique_ptr<OceanBuffer>, SwapChain::MAX_FRAMES_IN_FLIGHT> lightBuffers;
+        RenderQueue renderQueue;  // light indices keyed by camera distance, kept to reuse its capacity
     };
 }  // namespace Ocean
@@ -0,0 +1,682 @@
+#include "shadow_system.hpp"
+
+#include "camera.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace Ocean {
+
+    namespace {
+
+        constexpr uint32_t INITIAL_CASTER_CAPACITY = 1024;
+        constexpr float SQRT_TWO = 1.41421356f;
+
+        // view axes of a cube face, right x down == forward like the camera's view space. Faces
+        // are ordered +X, -X, +Y, -Y, +Z, -Z, the shaders pick them the same way
+        struct FaceBasis {
+            glm::vec3 forward;
+            glm::vec3 right;
+            glm::vec3 down;
+        };
+
+        const std::array<FaceBasis, ShadowSystem::FACE_COUNT> FACE_BASES{{
+                {{1.f, 0.f, 0.f}, {0.f, 0.f, -1.f}, {0.f, 1.f, 0.f}},
+                {{-1.f, 0.f, 0.f}, {0.f, 0.f, 1.f}, {0.f, 1.f, 0.f}},
+                {{0.f, 1.f, 0.f}, {1.f, 0.f, 0.f}, {0.f, 0.f, -1.f}},
+                {{0.f, -1.f, 0.f}, {1.f, 0.f, 0.f}, {0.f, 0.f, 1.f}},
+                {{0.f, 0.f, 1.f}, {1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}},
+                {{0.f, 0.f, -1.f}, {-1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}},
+        }};
+
+        // FaceCaster::key, casters of one face and pass end up next to each other, grouped by model
+        uint64_t casterKey(uint32_t faceUpdate, bool dynamic, ModelHandle model) {
+            return (static_cast<uint64_t>(faceUpdate) << 33) | (static_cast<uint64_t>(dynamic) << 32) | model;
+        }
+
+        // spreads the bits of an id, summing these gives an order independent set signature
+        uint64_t hashId(GameObject::id_t id) {
+            uint64_t hash = id + 0x9e3779b97f4a7c15ull;
+            hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+            hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+            return hash ^ (hash >> 31);
+        }
+
+    }  // namespace
+
+    ShadowSystem::ShadowSystem(Device &device, uint32_t shadowMapBudget, uint32_t resolution)
+            : device{device}, shadowMapBudget{shadowMapBudget}, resolution{resolution} {
+        assert(shadowMapBudget > 0 && "Shadow map budget must be at least one");
+        slots.resize(shadowMapBudget);
+        createImages();
+        createRenderPasses();
+        createFramebuffers();
+        createSampler();
+        createPipeline();
+        for (auto &casterBuffer: casterBuffers) {
+            OceanBuffer::reserve(
+                    device, casterBuffer, sizeof(uint32_t), INITIAL_CASTER_CAPACITY,
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        }
+    }
+
+    ShadowSystem::~ShadowSystem() {
+        vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+        vkDestroySampler(device.device(), sampler, nullptr);
+        for (size_t i = 0; i < cacheFramebuffers.size(); i++) {
+            vkDestroyFramebuffer(device.device(), cacheFramebuffers[i], nullptr);
+            vkDestroyFramebuffer(device.device(), compositeFramebuffers[i], nullptr);
+            vkDestroyImageView(device.device(), cacheLayerViews[i], nullptr);
+            vkDestroyImageView(device.device(), shadowLayerViews[i], nullptr);
+        }
+        vkDestroyRenderPass(device.device(), cacheRenderPass, nullptr);
+        vkDestroyRenderPass(device.device(), compositeRenderPass, nullptr);
+        vkDestroyImageView(device.device(), shadowImageView, nullptr);
+        vkDestroyImage(device.device(), shadowImage, nullptr);
+        vkFreeMemory(device.device(), shadowImageMemory, nullptr);
+        vkDestroyImage(device.device(), cacheImage, nullptr);
+        vkFreeMemory(device.device(), cacheImageMemory, nullptr);
+    }
+
+    void ShadowSystem::createImages() {
+        // compared with linear filtering, which gives 2x2 percentage closer filtering for free
+        depthFormat = device.findSupportedFormat(
+                {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM},
+                VK_IMAGE_TILING_OPTIMAL,
+                VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+        const uint32_t layerCount = shadowMapBudget * FACE_COUNT;
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = resolution;
+        imageInfo.extent.height = resolution;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = layerCount;
+        imageInfo.format = depthFormat;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                          VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, shadowImage, shadowImageMemory);
+        imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, cacheImage, cacheImageMemory);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = shadowImage;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+        viewInfo.format = depthFormat;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = layerCount;
+        if (vkCreateImageView(device.device(), &viewInfo, nullptr, &shadowImageView) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow map image view!");
+        }
+
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.subresourceRange.layerCount = 1;
+        shadowLayerViews.resize(layerCount);
+        cacheLayerViews.resize(layerCount);
+        for (uint32_t layer = 0; layer < layerCount; layer++) {
+            viewInfo.subresourceRange.baseArrayLayer = layer;
+            viewInfo.image = shadowImage;
+            if (vkCreateImageView(device.device(), &viewInfo, nullptr, &shadowLayerViews[layer]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create shadow map image view!");
+            }
+            viewInfo.image = cacheImage;
+            if (vkCreateImageView(device.device(), &viewInfo, nullptr, &cacheLayerViews[layer]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create shadow map image view!");
+            }
+        }
+
+        // the sampled array is bound every frame, layers no light owns yet are never read but
+        // still have to be in the layout of the descriptor
+        VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = shadowImage;
+        barrier.subresourceRange = viewInfo.subresourceRange;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = layerCount;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                0,
+                0,
+                nullptr,
+                0,
+                nullptr,
+                1,
+                &barrier);
+        device.endSingleTimeCommands(commandBuffer);
+    }
+
+    void ShadowSystem::createRenderPasses() {
+        // both passes have one depth attachment of the same format, so the pipeline works in either
+        auto createRenderPass = [this](
+                VkAttachmentLoadOp loadOp,
+                VkImageLayout initialLayout,
+                VkImageLayout finalLayout,
+                const std::array<VkSubpassDependency, 2> &dependencies,
+                VkRenderPass &renderPass) {
+            VkAttachmentDescription depthAttachment{};
+            depthAttachment.format = depthFormat;
+            depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+            depthAttachment.loadOp = loadOp;
+            depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+            depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            depthAttachment.initialLayout = initialLayout;
+            depthAttachment.finalLayout = finalLayout;
+
+            VkAttachmentReference depthAttachmentRef{};
+            depthAttachmentRef.attachment = 0;
+            depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+            VkSubpassDescription subpass{};
+            subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+            subpass.colorAttachmentCount = 0;
+            subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+            VkRenderPassCreateInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+            renderPassInfo.attachmentCount = 1;
+            renderPassInfo.pAttachments = &depthAttachment;
+            renderPassInfo.subpassCount = 1;
+            renderPassInfo.pSubpasses = &subpass;
+            renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+            renderPassInfo.pDependencies = dependencies.data();
+            if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create shadow render pass!");
+            }
+        };
+
+        std::array<VkSubpassDependency, 2> dependencies{};
+        VkSubpassDependency &in = dependencies[0];
+        in.srcSubpass = VK_SUBPASS_EXTERNAL;
+        in.dstSubpass = 0;
+        in.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        in.dstAccessMask =
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        VkSubpassDependency &out = dependencies[1];
+        out.srcSubpass = 0;
+        out.dstSubpass = VK_SUBPASS_EXTERNAL;
+        out.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        out.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        // cache: earlier copies out of the layer finish before it is cleared, the next copy reads it
+        in.srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        in.srcAccessMask = 0;
+        out.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        out.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        createRenderPass(
+                VK_ATTACHMENT_LOAD_OP_CLEAR,
+                VK_IMAGE_LAYOUT_UNDEFINED,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                dependencies,
+                cacheRenderPass);
+
+        // composite: dynamic casters go on top of the copied cache, lit geometry samples the result
+        in.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        out.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        out.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        createRenderPass(
+                VK_ATTACHMENT_LOAD_OP_LOAD,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                dependencies,
+                compositeRenderPass);
+    }
+
+    void ShadowSystem::createFramebuffers() {
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.width = resolution;
+        framebufferInfo.height = resolution;
+        framebufferInfo.layers = 1;
+
+        cacheFramebuffers.resize(cacheLayerViews.size());
+        compositeFramebuffers.resize(shadowLayerViews.size());
+        for (size_t layer = 0; layer < cacheLayerViews.size(); layer++) {
+            framebufferInfo.renderPass = cacheRenderPass;
+            framebufferInfo.pAttachments = &cacheLayerViews[layer];
+            if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr, &cacheFramebuffers[layer]) !=
+                VK_SUCCESS) {
+                throw std::runtime_error("failed to create framebuffer!");
+            }
+            framebufferInfo.renderPass = compositeRenderPass;
+            framebufferInfo.pAttachments = &shadowLayerViews[layer];
+            if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr, &compositeFramebuffers[layer]) !=
+                VK_SUCCESS) {
+                throw std::runtime_error("failed to create framebuffer!");
+            }
+        }
+    }
+
+    void ShadowSystem::createSampler() {
+        // texture() on a sampler2DArrayShadow returns how much of the footprint passes the compare
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = samplerInfo.addressModeU;
+        samplerInfo.addressModeW = samplerInfo.addressModeU;
+        samplerInfo.mipLodBias = 0.0f;
+        samplerInfo.maxAnisotropy = 1.0f;
+        samplerInfo.compareEnable = VK_TRUE;
+        samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+        samplerInfo.minLod = 0.0f;
+        samplerInfo.maxLod = 0.0f;
+
+        if (vkCreateSampler(device.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create sampler!");
+        }
+    }
+
+    void ShadowSystem::createPipeline() {
+        setLayout =
+                DescriptorSetLayout::Builder(device)
+                        .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                        .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                        .build();
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(glm::mat4);
+
+        VkDescriptorSetLayout descriptorSetLayout = setLayout->getDescriptorSetLayout();
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
+
+        // positions only and no color attachment, the bias keeps lit surfaces from shadowing
+        // themselves
+        PipelineConfigInfo pipelineConfig{};
+        Pipeline::defaultPipelineConfigInfo(pipelineConfig);
+        pipelineConfig.attributeDescriptions.resize(1);
+        pipelineConfig.colorBlendInfo.attachmentCount = 0;
+        pipelineConfig.rasterizationInfo.depthBiasEnable = VK_TRUE;
+        pipelineConfig.rasterizationInfo.depthBiasConstantFactor = 1.25f;
+        pipelineConfig.rasterizationInfo.depthBiasSlopeFactor = 1.75f;
+        pipelineConfig.renderPass = cacheRenderPass;
+        pipelineConfig.pipelineLayout = pipelineLayout;
+        pipeline = std::make_unique<Pipeline>(device, "shaders/shadow.vert.spv", "", pipelineConfig);
+    }
+
+    void ShadowSystem::update(FrameInfo &frameInfo) {
+        stats = Stats{};
+        faceUpdates.clear();
+        faceCasters.clear();
+        for (auto &light: frameInfo.gameObjectManager.pointLights.lights) {
+            light.shadowIndex = -1;
+        }
+
+        const Frustum cameraFrustum = frameInfo.camera.getFrustum();
+        assignSlots(frameInfo, cameraFrustum);
+        for (uint32_t slot = 0; slot < shadowMapBudget; slot++) {
+            if (slotLights[slot] < 0) continue;
+            gatherCasters(frameInfo, slot, cameraFrustum);
+            stats.shadowedLights++;
+        }
+        buildBatches(frameInfo);
+    }
+
+    void ShadowSystem::assignSlots(FrameInfo &frameInfo, const Frustum &cameraFrustum) {
+        auto &manager = frameInfo.gameObjectManager;
+        auto &pointLights = manager.pointLights;
+        const glm::vec3 cameraPosition = frameInfo.camera.getPosition();
+
+        candidates.clear();
+        for (uint32_t lightIndex = 0; lightIndex < pointLights.size(); lightIndex++) {
+            const auto &light = pointLights.lights[lightIndex];
+            if (!light.castsShadows) continue;
+            glm::vec3 position = manager.worldTranslation(pointLights.objectIndices[lightIndex]);
+            if (!cameraFrustum.intersects(Sphere{position, light.range})) continue;
+            glm::vec3 offset = position - cameraPosition;
+            candidates.emplace_back(glm::dot(offset, offset), lightIndex);
+        }
+        // the nearest lights get the budget
+        auto selectedEnd = candidates.begin() + std::min<size_t>(candidates.size(), shadowMapBudget);
+        std::partial_sort(candidates.begin(), selectedEnd, candidates.end());
+        candidates.erase(selectedEnd, candidates.end());
+
+        // a light selected again keeps its slot and with it the cached faces, the others take
+        // over slots nobody was selected for
+        auto lightIdOf = [&](uint32_t lightIndex) {
+            return manager.objects.ids[pointLights.objectIndices[lightIndex]];
+        };
+        slotLights.assign(shadowMapBudget, -1);
+        for (const auto &candidate: candidates) {
+            for (uint32_t slot = 0; slot < shadowMapBudget; slot++) {
+                if (slots[slot].lightId == lightIdOf(candidate.second)) {
+                    slotLights[slot] = static_cast<int32_t>(candidate.second);
+                    break;
+                }
+            }
+        }
+        uint32_t freeSlot = 0;
+        for (const auto &candidate: candidates) {
+            auto lightIndex = static_cast<int32_t>(candidate.second);
+            if (std::find(slotLights.begin(), slotLights.end(), lightIndex) != slotLights.end()) continue;
+            while (slotLights[freeSlot] >= 0) {
+                freeSlot++;
+            }
+            slotLights[freeSlot] = lightIndex;
+            slots[freeSlot] = ShadowSlot{};
+            slots[freeSlot].lightId = lightIdOf(candidate.second);
+        }
+
+        for (uint32_t slot = 0; slot < shadowMapBudget; slot++) {
+            if (slotLights[slot] >= 0) {
+                pointLights.lights[slotLights[slot]].shadowIndex = static_cast<int32_t>(slot);
+            }
+        }
+    }
+
+    void ShadowSystem::gatherCasters(FrameInfo &frameInfo, uint32_t slotIndex, const Frustum &cameraFrustum) {
+        const auto &manager = frameInfo.gameObjectManager;
+        const auto &objects = manager.objects;
+        const auto lightIndex = static_cast<uint32_t>(slotLights[slotIndex]);
+        const auto &light = manager.pointLights.lights[lightIndex];
+        const glm::vec3 position = manager.worldTranslation(manager.pointLights.objectIndices[lightIndex]);
+
+        ShadowSlot &slot = slots[slotIndex];
+        if (position != slot.position || light.range != slot.range) {
+            // every cached face was rendered from somewhere else
+            for (auto &face: slot.faces) {
+                face.staticValid = false;
+            }
+            slot.position = position;
+            slot.range = light.range;
+        }
+
+        // the box of a face's pyramid, cut off at the range, bounds everything the face can shade
+        std::array<uint32_t, FACE_COUNT> updateIndices{};
+        bool anyVisible = false;
+        for (uint32_t face = 0; face < FACE_COUNT; face++) {
+            const FaceBasis &basis = FACE_BASES[face];
+            AABB bounds{position, position};
+            for (float x: {-1.f, 1.f}) {
+                for (float y: {-1.f, 1.f}) {
+                    bounds.expand(position + light.range * (basis.forward + x * basis.right + y * basis.down));
+                }
+            }
+            if (!cameraFrustum.intersects(bounds)) {
+                updateIndices[face] = INVALID_HANDLE;
+                stats.skippedFaces++;
+                continue;
+            }
+
+            Camera faceCamera{};
+            faceCamera.setPerspectiveProjection(glm::half_pi<float>(), 1.f, NEAR_PLANE, light.range);
+            faceCamera.setViewDirection(position, basis.forward, -basis.down);
+            FaceUpdate update{};
+            update.layer = slotIndex * FACE_COUNT + face;
+            update.viewProjection = faceCamera.getProjection() * faceCamera.getView();
+            updateIndices[face] = static_cast<uint32_t>(faceUpdates.size());
+            faceUpdates.push_back(update);
+            anyVisible = true;
+        }
+        if (!anyVisible) return;
+
+        // a caster is seen by a face if its sphere reaches into the face's pyramid, whose side
+        // planes are |right| <= forward and |down| <= forward
+        std::array<uint64_t, FACE_COUNT> staticSignatures{};
+        std::array<bool, FACE_COUNT> hasDynamic{};
+        manager.getSpatialIndex().query(Sphere{position, light.range}, [&](uint32_t id) {
+            uint32_t index = manager.indexOf(id);
+            ModelHandle model = objects.models[index];
+            if (model == INVALID_HANDLE) return;
+            glm::vec3 offset =
+                    glm::vec3{objects.sphereCentersX[index], objects.sphereCentersY[index],
+                              objects.sphereCentersZ[index]} - position;
+            float radius = objects.sphereRadii[index];
+            float reach = light.range + radius;
+            if (glm::dot(offset, offset) > reach * reach) return;
+
+            const bool isStatic = manager.isStatic(index);
+            const float slack = -radius * SQRT_TWO;
+            for (uint32_t face = 0; face < FACE_COUNT; face++) {
+                if (updateIndices[face] == INVALID_HANDLE) continue;
+                const FaceBasis &basis = FACE_BASES[face];
+                float depth = glm::dot(offset, basis.forward);
+                if (depth - std::abs(glm::dot(offset, basis.right)) < slack ||
+                    depth - std::abs(glm::dot(offset, basis.down)) < slack) {
+                    continue;
+                }
+                if (isStatic) {
+                    staticSignatures[face] += hashId(id);
+                } else {
+                    hasDynamic[face] = true;
+                }
+                faceCasters.push_back(FaceCaster{casterKey(updateIndices[face], !isStatic, model), index});
+            }
+        });
+
+        // the cache is rendered again when its static casters changed, the sampled layer is
+        // composited again when the cache changed or moving casters were or are in it
+        for (uint32_t face = 0; face < FACE_COUNT; face++) {
+            if (updateIndices[face] == INVALID_HANDLE) continue;
+            FaceState &state = slot.faces[face];
+            FaceUpdate &update = faceUpdates[updateIndices[face]];
+            update.renderCache = !state.staticValid || state.staticSignature != staticSignatures[face];
+            update.composite = update.renderCache || hasDynamic[face] || state.compositeHasDynamic;
+            state.staticValid = true;
+            state.staticSignature = staticSignatures[face];
+            state.compositeHasDynamic = hasDynamic[face];
+            stats.cachedFaces += update.renderCache ? 1 : 0;
+            stats.compositedFaces += update.composite ? 1 : 0;
+        }
+    }
+
+    void ShadowSystem::buildBatches(FrameInfo &frameInfo) {
+        // sorted, every face's static and dynamic casters are runs split into one batch per model
+        std::sort(faceCasters.begin(), faceCasters.end(), [](const FaceCaster &a, const FaceCaster &b) {
+            return a.key < b.key;
+        });
+        batches.clear();
+        casterIndices.clear();
+        uint64_t batchKey = ~0ull;
+        for (const FaceCaster &caster: faceCasters) {
+            FaceUpdate &update = faceUpdates[caster.key >> 33];
+            const auto pass = static_cast<uint32_t>((caster.key >> 32) & 1);
+            // static casters of faces whose cache is still valid are not drawn
+            if (pass == 0 && !update.renderCache) continue;
+            if (caster.key != batchKey) {
+                if (update.batchCount[pass] == 0) {
+                    update.firstBatch[pass] = static_cast<uint32_t>(batches.size());
+                }
+                update.batchCount[pass]++;
+                batches.push_back(CasterBatch{
+                        static_cast<ModelHandle>(caster.key & 0xffffffffu),
+                        static_cast<uint32_t>(casterIndices.size()),
+                        0});
+                batchKey = caster.key;
+            }
+            batches.back().instanceCount++;
+            casterIndices.push_back(caster.objectIndex);
+        }
+        stats.casterDraws = static_cast<uint32_t>(batches.size());
+
+        auto &casterBuffer = casterBuffers[frameInfo.frameIndex];
+        OceanBuffer::reserve(
+                device, casterBuffer, sizeof(uint32_t), static_cast<uint32_t>(casterIndices.size()),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        if (!casterIndices.empty()) {
+            casterBuffer->writeToBuffer(casterIndices.data(), casterIndices.size() * sizeof(uint32_t));
+            casterBuffer->flush();
+        }
+    }
+
+    void ShadowSystem::render(FrameInfo &frameInfo) {
+        VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+
+        // composited layers become copy destinations once earlier frames stopped sampling them
+        compositeBarriers.clear();
+        for (const FaceUpdate &update: faceUpdates) {
+            if (!update.composite) continue;
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = shadowImage;
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+            barrier.subresourceRange.baseMipLevel = 0;
+            barrier.subresourceRange.levelCount = 1;
+            barrier.subresourceRange.baseArrayLayer = update.layer;
+            barrier.subresourceRange.layerCount = 1;
+            barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            compositeBarriers.push_back(barrier);
+        }
+        if (compositeBarriers.empty()) return;
+        vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0,
+                0,
+                nullptr,
+                0,
+                nullptr,
+                static_cast<uint32_t>(compositeBarriers.size()),
+                compositeBarriers.data());
+
+        auto objectBufferInfo = frameInfo.gameObjectManager.getObjectBufferInfo(frameInfo.frameIndex);
+        auto casterBufferInfo = casterBuffers[frameInfo.frameIndex]->descriptorInfo();
+        VkDescriptorSet descriptorSet;
+        DescriptorWriter(*setLayout, frameInfo.descriptorCache)
+                .writeBuffer(0, &objectBufferInfo)
+                .writeBuffer(1, &casterBufferInfo)
+                .build(descriptorSet);
+
+        // bound state lasts across the render passes below, both are compatible with the pipeline
+        VkViewport viewport{0.f, 0.f, static_cast<float>(resolution), static_cast<float>(resolution), 0.f, 1.f};
+        VkRect2D scissor{{0, 0}, {resolution, resolution}};
+        pipeline->bind(commandBuffer);
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        vkCmdBindDescriptorSets(
+                commandBuffer,
+                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                pipelineLayout,
+                0,
+                1,
+                &descriptorSet,
+                0,
+                nullptr);
+        frameInfo.gameObjectManager.getMeshPool().bind(commandBuffer);
+
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderArea = scissor;
+        VkClearValue clearValue{};
+        clearValue.depthStencil = {1.0f, 0};
+
+        for (const FaceUpdate &update: faceUpdates) {
+            if (!update.composite) continue;
+            vkCmdPushConstants(
+                    commandBuffer,
+                    pipelineLayout,
+                    VK_SHADER_STAGE_VERTEX_BIT,
+                    0,
+                    sizeof(glm::mat4),
+                    &update.viewProjection);
+
+            if (update.renderCache) {
+                renderPassInfo.renderPass = cacheRenderPass;
+                renderPassInfo.framebuffer = cacheFramebuffers[update.layer];
+                renderPassInfo.clearValueCount = 1;
+                renderPassInfo.pClearValues = &clearValue;
+                vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+                drawBatches(frameInfo, update.firstBatch[0], update.batchCount[0]);
+                vkCmdEndRenderPass(commandBuffer);
+            }
+
+            VkImageCopy region{};
+            region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+            region.srcSubresource.mipLevel = 0;
+            region.srcSubresource.baseArrayLayer = update.layer;
+            region.srcSubresource.layerCount = 1;
+            region.dstSubresource = region.srcSubresource;
+            region.extent = {resolution, resolution, 1};
+            vkCmdCopyImage(
+                    commandBuffer,
+                    cacheImage,
+                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    shadowImage,
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    1,
+                    &region);
+
+            // also moves the layer back to the sampled layout when there is nothing to draw
+            renderPassInfo.renderPass = compositeRenderPass;
+            renderPassInfo.framebuffer = compositeFramebuffers[update.layer];
+            renderPassInfo.clearValueCount = 0;
+            renderPassInfo.pClearValues = nullptr;
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            drawBatches(frameInfo, update.firstBatch[1], update.batchCount[1]);
+            vkCmdEndRenderPass(commandBuffer);
+        }
+    }
+
+    void ShadowSystem::drawBatches(FrameInfo &frameInfo, uint32_t firstBatch, uint32_t batchCount) const {
+        const MeshPool &meshPool = frameInfo.gameObjectManager.getMeshPool();
+        for (uint32_t i = firstBatch; i < firstBatch + batchCount; i++) {
+            const CasterBatch &batch = batches[i];
+            const auto &mesh = meshPool.getMesh(batch.model);
+            vkCmdDrawIndexed(
+                    frameInfo.commandBuffer,
+                    mesh.indexCount,
+                    batch.instanceCount,
+                    mesh.firstIndex,
+                    mesh.vertexOffset,
+                    batch.firstInstance);
+        }
+    }
+
+    VkDescriptorImageInfo ShadowSystem::getShadowMapInfo() const {
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.sampler = sampler;
+        imageInfo.imageView = shadowImageView;
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        return imageInfo;
+    }
+
+}  // namespace Ocean
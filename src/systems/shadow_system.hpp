@@ -0,0 +1,161 @@
+#pragma once
+
+#include "frame_info.hpp"
+#include "geometry.hpp"
+#include "vulkan/buffer.hpp"
+#include "vulkan/descriptors.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/pipeline.hpp"
+#include "vulkan/swap_chain.hpp"
+
+// std
+#include <array>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Ocean {
+
+    // Omnidirectional point light shadows. Every shadowed light owns six layers of a 2D array depth
+    // image, one per cube face, each rendered with a 90 degree perspective projection reaching the
+    // light's range. Casters that stopped moving (GameObjectManager::isStatic) are drawn into a
+    // second array that is only rendered again when the light or the static casters of a face
+    // change, every frame that cache is copied into the sampled array and the moving casters are
+    // drawn on top. Faces outside the camera frustum are neither rendered nor composited.
+    class ShadowSystem {
+    public:
+        static constexpr uint32_t FACE_COUNT = 6;
+        // near plane of every face projection, lighting.glsl uses the same value to rebuild the
+        // depth
+        static constexpr float NEAR_PLANE = 0.05f;
+
+        // of the last update
+        struct Stats {
+            uint32_t shadowedLights = 0;
+            uint32_t skippedFaces = 0;  // outside the camera frustum
+            uint32_t cachedFaces = 0;  // static casters rendered again
+            uint32_t compositedFaces = 0;  // cache copied and dynamic casters drawn
+            uint32_t casterDraws = 0;
+        };
+
+        // shadowMapBudget is the number of lights given a shadow map each frame, the nearest ones
+        // reaching into the camera frustum win. resolution is the width and height of a face
+        ShadowSystem(Device &device, uint32_t shadowMapBudget, uint32_t resolution);
+
+        ~ShadowSystem();
+
+        ShadowSystem(const ShadowSystem &) = delete;
+
+        ShadowSystem &operator=(const ShadowSystem &) = delete;
+
+        // picks this frame's shadowed lights, writes their PointLightComponent::shadowIndex and
+        // gathers the casters of every face. Runs after the game object buffer is updated and
+        // before LightClusterGrid::build
+        void update(FrameInfo &frameInfo);
+
+        // records this frame's cache and composite passes, outside of any render pass
+        void render(FrameInfo &frameInfo);
+
+        // every layer with a depth comparison sampler, for a sampler2DArrayShadow
+        [[nodiscard]] VkDescriptorImageInfo getShadowMapInfo() const;
+
+        [[nodiscard]] uint32_t getShadowMapBudget() const { return shadowMapBudget; }
+
+        [[nodiscard]] const Stats &getStats() const { return stats; }
+
+    private:
+        struct FaceState {
+            bool staticValid = false;  // the cache layer holds this face's static casters
+            uint64_t staticSignature = 0;  // of the static casters in the cache layer
+            bool compositeHasDynamic = false;  // the sampled layer holds more than the cache
+        };
+
+        struct ShadowSlot {
+            GameObject::id_t lightId = INVALID_HANDLE;
+            glm::vec3 position{};
+            float range = 0.f;
+            std::array<FaceState, FACE_COUNT> faces{};
+        };
+
+        // a run of casters drawn with one model
+        struct CasterBatch {
+            ModelHandle model;
+            uint32_t firstInstance;
+            uint32_t instanceCount;
+        };
+
+        // work recorded for one visible face this frame
+        struct FaceUpdate {
+            uint32_t layer;
+            glm::mat4 viewProjection;
+            bool renderCache;  // static casters changed, the cache layer is rendered first
+            bool composite;  // the sampled layer is out of date
+            uint32_t firstBatch[2];  // static and dynamic casters
+            uint32_t batchCount[2];
+        };
+
+        // a caster seen by a face, sorted into batches
+        struct FaceCaster {
+            uint64_t key;  // face update, static or dynamic, then model
+            uint32_t objectIndex;
+        };
+
+        void createImages();
+
+        void createRenderPasses();
+
+        void createFramebuffers();
+
+        void createSampler();
+
+        void createPipeline();
+
+        // picks the lights and keeps every light that stays selected in its slot
+        void assignSlots(FrameInfo &frameInfo, const Frustum &cameraFrustum);
+
+        void gatherCasters(FrameInfo &frameInfo, uint32_t slotIndex, const Frustum &cameraFrustum);
+
+        void buildBatches(FrameInfo &frameInfo);
+
+        void drawBatches(FrameInfo &frameInfo, uint32_t firstBatch, uint32_t batchCount) const;
+
+        Device &device;
+        const uint32_t shadowMapBudget;
+        const uint32_t resolution;
+        VkFormat depthFormat{};
+
+        // the sampled array rests in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, the cache in
+        // VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL once rendered
+        VkImage shadowImage = VK_NULL_HANDLE;
+        VkDeviceMemory shadowImageMemory = VK_NULL_HANDLE;
+        VkImageView shadowImageView = VK_NULL_HANDLE;  // every layer
+        std::vector<VkImageView> shadowLayerViews;
+        VkImage cacheImage = VK_NULL_HANDLE;
+        VkDeviceMemory cacheImageMemory = VK_NULL_HANDLE;
+        std::vector<VkImageView> cacheLayerViews;
+        VkSampler sampler{};
+
+        // the cache pass clears and ends ready to be copied, the composite pass loads the copy
+        VkRenderPass cacheRenderPass = VK_NULL_HANDLE;
+        VkRenderPass compositeRenderPass = VK_NULL_HANDLE;
+        std::vector<VkFramebuffer> cacheFramebuffers;
+        std::vector<VkFramebuffer> compositeFramebuffers;
+
+        std::unique_ptr<DescriptorSetLayout> setLayout;
+        VkPipelineLayout pipelineLayout{};
+        std::unique_ptr<Pipeline> pipeline;
+        std::array<std::unique_ptr<OceanBuffer>, SwapChain::MAX_FRAMES_IN_FLIGHT> casterBuffers;
+
+        std::vector<ShadowSlot> slots;
+        Stats stats{};
+        // scratch, kept to reuse their capacity
+        std::vector<std::pair<float, uint32_t>> candidates;  // squared camera distance, light index
+        std::vector<int32_t> slotLights;  // light index per slot this frame, -1 if unused
+        std::vector<FaceUpdate> faceUpdates;
+        std::vector<FaceCaster> faceCasters;
+        std::vector<uint32_t> casterIndices;
+        std::vector<CasterBatch> batches;
+        std::vector<VkImageMemoryBarrier> compositeBarriers;
+    };
+
+}  // namespace Ocean
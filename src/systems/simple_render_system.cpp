@@ -1,5 +1,7 @@
 #include "simple_render_system.hpp"
 
+#include "culling.hpp"
+
 // libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -8,60 +10,88 @@
 #include <glm/gtc/constants.hpp>
 
 // std
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
 #include <stdexcept>
 
 namespace Ocean {
 
-    struct SimplePushConstantData {
-        glm::mat4 modelMatrix{1.f};
-        glm::mat4 normalMatrix{1.f};
-    };
+    namespace {
+
+        constexpr uint32_t CULL_WORKGROUP_SIZE = 64;  // local_size_x of cull.comp
+
+    }  // namespace
 
     SimpleRenderSystem::SimpleRenderSystem(
-            Device &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
-            : device{device} {
-        createPipelineLayout(globalSetLayout);
-        createPipeline(renderPass);
+            Device &device,
+            VkRenderPass renderPass,
+            VkRenderPass deferredRenderPass,
+            VkDescriptorSetLayout globalSetLayout,
+            VkDescriptorSetLayout textureSetLayout,
+            VkDescriptorSetLayout lightSetLayout)
+            : device{device}, depthPyramid{device} {
+        createPipelineLayout(globalSetLayout, textureSetLayout, lightSetLayout);
+        createPipelines(renderPass, deferredRenderPass);
+        createCullPipeline(globalSetLayout);
+        for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+            OceanBuffer::reserve(
+                    device, instanceBuffers[i], sizeof(InstanceData), INITIAL_INSTANCE_CAPACITY,
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+            OceanBuffer::reserve(
+                    device, indirectBuffers[i], sizeof(VkDrawIndexedIndirectCommand), INITIAL_INSTANCE_CAPACITY,
+                    VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+            OceanBuffer::reserve(
+                    device, cullInstanceBuffers[i], sizeof(CullInstance), INITIAL_INSTANCE_CAPACITY,
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+            OceanBuffer::reserve(
+                    device, visibleInstanceBuffers[i], sizeof(InstanceData), INITIAL_INSTANCE_CAPACITY,
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            OceanBuffer::reserve(device, countBuffers[i], sizeof(uint32_t), 3, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+            OceanBuffer::reserve(
+                    device, recheckBuffers[i], sizeof(uint32_t), INITIAL_INSTANCE_CAPACITY,
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        }
+        setDrawSubmission(drawSubmission);
     }
 
     SimpleRenderSystem::~SimpleRenderSystem() {
         vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+        vkDestroyPipelineLayout(device.device(), cullPipelineLayout, nullptr);
     }
 
-    void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(SimplePushConstantData);
-
-        renderSystemLayout =
+    void SimpleRenderSystem::createPipelineLayout(
+            VkDescriptorSetLayout globalSetLayout,
+            VkDescriptorSetLayout textureSetLayout,
+            VkDescriptorSetLayout lightSetLayout) {
+        // set 1 is bound once per frame: object data and the instance -> object mapping
+        objectSetLayout =
                 DescriptorSetLayout::Builder(device)
-                        .addBinding(
-                                0,
-                                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-                        .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                        .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                        .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
                         .build();
-
+        // set 2 is the texture table, indexed by the material index of an instance, set 3 the
+        // light clusters
         std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
                 globalSetLayout,
-                renderSystemLayout->getDescriptorSetLayout()};
+                objectSetLayout->getDescriptorSetLayout(),
+                textureSetLayout,
+                lightSetLayout};
 
         VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
         pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        pipelineLayoutInfo.pushConstantRangeCount = 0;
+        pipelineLayoutInfo.pPushConstantRanges = nullptr;
         if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
             VK_SUCCESS) {
             throw std::runtime_error("failed to create pipeline layout!");
         }
     }
 
-    void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
+    void SimpleRenderSystem::createPipelines(VkRenderPass renderPass, VkRenderPass deferredRenderPass) {
         assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
         PipelineConfigInfo pipelineConfig{};
@@ -73,60 +103,511 @@ namespace Ocean {
                 "shaders/basic_shader.vert.spv",
                 "shaders/basic_shader.frag.spv",
                 pipelineConfig);
+
+        // the pre-pass has written the final depth, shading only passes where it matches
+        pipelineConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+        pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+        depthEqualPipeline = std::make_unique<Pipeline>(
+                device,
+                "shaders/basic_shader.vert.spv",
+                "shaders/basic_shader.frag.spv",
+                pipelineConfig);
+
+        // positions only, no fragment stage and no color writes
+        pipelineConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+        pipelineConfig.depthStencilInfo.depthWriteEnable = VK_TRUE;
+        pipelineConfig.colorBlendAttachment.colorWriteMask = 0;
+        pipelineConfig.attributeDescriptions.resize(1);
+        depthPrepassPipeline = std::make_unique<Pipeline>(
+                device,
+                "shaders/depth_prepass.vert.spv",
+                "",
+                pipelineConfig);
+
+        // same vertex stage, the fragment stage writes surface attributes instead of shading
+        PipelineConfigInfo gBufferConfig{};
+        Pipeline::defaultPipelineConfigInfo(gBufferConfig);
+        std::array<VkPipelineColorBlendAttachmentState, 2> gBufferBlendAttachments{
+                gBufferConfig.colorBlendAttachment, gBufferConfig.colorBlendAttachment};
+        gBufferConfig.colorBlendInfo.attachmentCount = static_cast<uint32_t>(gBufferBlendAttachments.size());
+        gBufferConfig.colorBlendInfo.pAttachments = gBufferBlendAttachments.data();
+        gBufferConfig.renderPass = deferredRenderPass;
+        gBufferConfig.subpass = SwapChain::GBUFFER_SUBPASS;
+        gBufferConfig.pipelineLayout = pipelineLayout;
+        gBufferPipeline = std::make_unique<Pipeline>(
+                device,
+                "shaders/basic_shader.vert.spv",
+                "shaders/gbuffer.frag.spv",
+                gBufferConfig);
     }
 
-    void SimpleRenderSystem::renderGameObjects(FrameInfo &frameInfo) {
-        pipeline->bind(frameInfo.commandBuffer);
+    void SimpleRenderSystem::createCullPipeline(VkDescriptorSetLayout globalSetLayout) {
+        cullSetLayout =
+                DescriptorSetLayout::Builder(device)
+                        .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .addBinding(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                        .build();
+
+        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
+                globalSetLayout,
+                cullSetLayout->getDescriptorSetLayout()};
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(CullPush);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &cullPipelineLayout) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
+
+        cullPipeline = std::make_unique<ComputePipeline>(device, "shaders/cull.comp.spv", cullPipelineLayout);
+    }
+
+    void SimpleRenderSystem::setDrawSubmission(DrawSubmission submission) {
+        if (submission != DrawSubmission::Direct && !device.enabledFeatures.drawIndirectFirstInstance) {
+            submission = DrawSubmission::Direct;
+        }
+        drawSubmission = submission;
+    }
+
+    void SimpleRenderSystem::cullObjects(FrameInfo &frameInfo) {
+        const auto &objects = frameInfo.gameObjectManager.objects;
+        const Frustum frustum = frameInfo.camera.getFrustum();
+        visibility.resize(objects.size());
+        frameInfo.jobSystem.parallelFor(0, objects.size(), CULL_BATCH_SIZE, [&](uint32_t first, uint32_t last) {
+            cullSpheres(
+                    objects.sphereCentersX.data() + first,
+                    objects.sphereCentersY.data() + first,
+                    objects.sphereCentersZ.data() + first,
+                    objects.sphereRadii.data() + first,
+                    last - first,
+                    frustum,
+                    visibility.data() + first);
+        });
+    }
+
+    void SimpleRenderSystem::buildBatches(FrameInfo &frameInfo) {
+        const auto &objects = frameInfo.gameObjectManager.objects;
+
+        // GPU culled frames upload every candidate with its batch, cull.comp writes the instance
+        // data of the visible ones
+        const bool gpuCulled = drawSubmission == DrawSubmission::GpuCulled;
+        if (!gpuCulled) {
+            cullObjects(frameInfo);
+        }
+
+        // sorted so instances of a batch are contiguous and, within a batch, front to back. GPU
+        // culled batches fill their instances in whatever order cull.comp finishes
+        const glm::mat4 &view = frameInfo.camera.getView();
+        const glm::vec3 viewForward{view[0][2], view[1][2], view[2][2]};
+        cullStats = CullStats{};
+        renderQueue.clear();
+        for (uint32_t i = 0; i < objects.size(); i++) {
+            if (objects.models[i] == INVALID_HANDLE) continue;
+            if (!gpuCulled) {
+                cullStats.tested++;
+                if (!visibility[i]) {
+                    cullStats.culled++;
+                    continue;
+                }
+            }
+            glm::vec3 center{objects.sphereCentersX[i], objects.sphereCentersY[i], objects.sphereCentersZ[i]};
+            float viewDepth = glm::dot(viewForward, center) + view[3][2];
+            renderQueue.push(
+                    RenderQueue::makeKey(
+                            RenderQueue::Pass::Opaque, 0, objects.textures[i], objects.models[i], viewDepth),
+                    i);
+        }
+        cullStats.drawn = static_cast<uint32_t>(renderQueue.size());
+        renderQueue.sort();
+
+        instances.clear();
+        cullInstances.clear();
+        batches.clear();
+        uint32_t instanceCount = 0;
+        uint64_t batchState = 0;
+        for (const auto &[key, objectIndex]: renderQueue.getEntries()) {
+            auto texture = static_cast<TextureHandle>(RenderQueue::materialOf(key));
+            auto model = static_cast<ModelHandle>(RenderQueue::meshOf(key));
+            if (batches.empty() || RenderQueue::stateOf(key) != batchState) {
+                batchState = RenderQueue::stateOf(key);
+                batches.push_back(InstanceBatch{model, texture, instanceCount, 0});
+            }
+            // the texture handle doubles as material index until materials exist
+            if (gpuCulled) {
+                cullInstances.push_back(
+                        CullInstance{objectIndex, texture, static_cast<uint32_t>(batches.size() - 1)});
+            } else {
+                instances.push_back(InstanceData{objectIndex, texture});
+            }
+            batches.back().instanceCount++;
+            instanceCount++;
+        }
+        if (instanceCount == 0) return;
+
+        if (gpuCulled) {
+            auto &cullInstanceBuffer = cullInstanceBuffers[frameInfo.frameIndex];
+            OceanBuffer::reserve(
+                    device, cullInstanceBuffer, sizeof(CullInstance), instanceCount,
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+            cullInstanceBuffer->writeToBuffer(cullInstances.data(), cullInstances.size() * sizeof(CullInstance));
+            cullInstanceBuffer->flush();
+            // phase 2 of occlusion culling fills a second copy of every batch's instance range
+            OceanBuffer::reserve(
+                    device, visibleInstanceBuffers[frameInfo.frameIndex], sizeof(InstanceData),
+                    occlusionActive ? 2 * instanceCount : instanceCount,
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            OceanBuffer::reserve(
+                    device, recheckBuffers[frameInfo.frameIndex], sizeof(uint32_t), instanceCount,
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        } else {
+            auto &instanceBuffer = instanceBuffers[frameInfo.frameIndex];
+            OceanBuffer::reserve(
+                    device, instanceBuffer, sizeof(InstanceData), instanceCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+            instanceBuffer->writeToBuffer(instances.data(), instances.size() * sizeof(InstanceData));
+            instanceBuffer->flush();
+        }
+    }
+
+    void SimpleRenderSystem::writeIndirectCommands(FrameInfo &frameInfo) {
+        const MeshPool &meshPool = frameInfo.gameObjectManager.getMeshPool();
+        const bool gpuCulled = drawSubmission == DrawSubmission::GpuCulled;
+        indirectCommands.clear();
+        for (const auto &batch: batches) {
+            const auto &mesh = meshPool.getMesh(batch.model);
+            indirectCommands.push_back(VkDrawIndexedIndirectCommand{
+                    mesh.indexCount,
+                    gpuCulled ? 0 : batch.instanceCount,
+                    mesh.firstIndex,
+                    mesh.vertexOffset,
+                    batch.firstInstance});
+        }
+        if (occlusionActive) {
+            // phase 2 commands, their instances follow every phase 1 instance
+            auto batchCount = static_cast<uint32_t>(batches.size());
+            auto instanceCount = static_cast<uint32_t>(cullInstances.size());
+            for (uint32_t i = 0; i < batchCount; i++) {
+                VkDrawIndexedIndirectCommand command = indirectCommands[i];
+                command.firstInstance += instanceCount;
+                indirectCommands.push_back(command);
+            }
+        }
 
+        auto &indirectBuffer = indirectBuffers[frameInfo.frameIndex];
+        OceanBuffer::reserve(
+                device, indirectBuffer, sizeof(VkDrawIndexedIndirectCommand),
+                static_cast<uint32_t>(indirectCommands.size()),
+                VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        indirectBuffer->writeToBuffer(
+                indirectCommands.data(), indirectCommands.size() * sizeof(VkDrawIndexedIndirectCommand));
+        indirectBuffer->flush();
+    }
+
+    void SimpleRenderSystem::recordCulling(FrameInfo &frameInfo) {
+        const int frameIndex = frameInfo.frameIndex;
+
+        // the fence of this frame index has been waited on, so the counts written by its last
+        // dispatches are final
+        auto &countBuffer = *countBuffers[frameIndex];
+        if (countPending[frameIndex]) {
+            countBuffer.invalidate();
+            const auto *counts = static_cast<const uint32_t *>(countBuffer.getMappedMemory());
+            recordStats.gpuVisibleInstances = counts[0];
+            recordStats.gpuOccludedInstances = counts[1];
+        }
+        std::array<uint32_t, 3> zeros{};
+        countBuffer.writeToBuffer(zeros.data(), sizeof(zeros));
+        countBuffer.flush();
+        countPending[frameIndex] = true;
+
+        // always bound, unbuilt pyramids are never sampled
+        depthPyramid.resize(frameInfo.renderer.getSwapChainExtent());
+
+        auto boundsBufferInfo = frameInfo.gameObjectManager.getBoundsBufferInfo(frameIndex);
+        auto cullInstanceBufferInfo = cullInstanceBuffers[frameIndex]->descriptorInfo();
+        auto indirectBufferInfo = indirectBuffers[frameIndex]->descriptorInfo();
+        auto visibleInstanceBufferInfo = visibleInstanceBuffers[frameIndex]->descriptorInfo();
+        auto countBufferInfo = countBuffer.descriptorInfo();
+        auto depthPyramidInfo = depthPyramid.getImageInfo();
+        auto recheckBufferInfo = recheckBuffers[frameIndex]->descriptorInfo();
+        DescriptorWriter(*cullSetLayout, frameInfo.descriptorCache)
+                .writeBuffer(0, &boundsBufferInfo)
+                .writeBuffer(1, &cullInstanceBufferInfo)
+                .writeBuffer(2, &indirectBufferInfo)
+                .writeBuffer(3, &visibleInstanceBufferInfo)
+                .writeBuffer(4, &countBufferInfo)
+                .writeImage(5, &depthPyramidInfo)
+                .writeBuffer(6, &recheckBufferInfo)
+                .build(cullDescriptorSet);
+
+        // the pyramid still holds the previous frame's depth, its build ended with a compute
+        // barrier that orders it before this dispatch
+        dispatchCulling(
+                frameInfo,
+                1,
+                depthPyramid.getViewProjection(),
+                occlusionActive && depthPyramid.isBuilt());
+    }
+
+    void SimpleRenderSystem::dispatchCulling(
+            FrameInfo &frameInfo, uint32_t phase, const glm::mat4 &occlusionViewProjection, bool occlusionEnabled) {
+        cullPipeline->bind(frameInfo.commandBuffer);
+        std::array<VkDescriptorSet, 2> descriptorSets{frameInfo.globalDescriptorSet, cullDescriptorSet};
         vkCmdBindDescriptorSets(
                 frameInfo.commandBuffer,
+                VK_PIPELINE_BIND_POINT_COMPUTE,
+                cullPipelineLayout,
+                0,
+                static_cast<uint32_t>(descriptorSets.size()),
+                descriptorSets.data(),
+                0,
+                nullptr);
+        // phase 2 reads its instance count from the count buffer, all instances bound the dispatch
+        CullPush push{};
+        push.occlusionViewProjection = occlusionViewProjection;
+        push.instanceCount = static_cast<uint32_t>(cullInstances.size());
+        push.batchCount = static_cast<uint32_t>(batches.size());
+        push.phase = phase;
+        push.occlusionEnabled = occlusionEnabled ? 1 : 0;
+        vkCmdPushConstants(
+                frameInfo.commandBuffer,
+                cullPipelineLayout,
+                VK_SHADER_STAGE_COMPUTE_BIT,
+                0,
+                sizeof(CullPush),
+                &push);
+        vkCmdDispatch(
+                frameInfo.commandBuffer,
+                (push.instanceCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE,
+                1,
+                1);
+
+        // draws read the commands and visible instances, the host reads the counts once the
+        // frame's fence signals
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask =
+                VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(
+                frameInfo.commandBuffer,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                0,
+                1,
+                &barrier,
+                0,
+                nullptr,
+                0,
+                nullptr);
+    }
+
+    void SimpleRenderSystem::cullOccluded(FrameInfo &frameInfo) {
+        assert(occlusionActive && "Cannot cull occluded objects when occlusion culling is not active");
+        auto recordStart = std::chrono::high_resolution_clock::now();
+
+        // the pyramid build starts with a compute barrier, so phase 2 sees the recheck queue
+        const glm::mat4 viewProjection = frameInfo.camera.getProjection() * frameInfo.camera.getView();
+        depthPyramid.build(
+                frameInfo.commandBuffer,
+                frameInfo.renderer.getCurrentDepthImageView(),
+                viewProjection,
+                frameInfo.descriptorCache);
+        dispatchCulling(frameInfo, 2, viewProjection, true);
+
+        recordStats.milliseconds += std::chrono::duration<double, std::chrono::milliseconds::period>(
+                std::chrono::high_resolution_clock::now() - recordStart).count();
+    }
+
+    void SimpleRenderSystem::prepareFrame(FrameInfo &frameInfo) {
+        auto recordStart = std::chrono::high_resolution_clock::now();
+        // the G-buffer is drawn in a single subpass, there is no pre-pass and nothing to split
+        // the render pass around
+        const bool deferred = frameInfo.shadingPath == ShadingPath::Deferred;
+        prepassActive = depthPrepass && !deferred;
+        shadingPipeline = deferred ? gBufferPipeline.get()
+                          : prepassActive ? depthEqualPipeline.get()
+                          : pipeline.get();
+        occlusionActive = occlusionCulling && !deferred && drawSubmission == DrawSubmission::GpuCulled;
+        buildBatches(frameInfo);
+        occlusionActive = occlusionActive && !batches.empty();
+        if (!batches.empty() && drawSubmission != DrawSubmission::Direct) {
+            writeIndirectCommands(frameInfo);
+            if (drawSubmission == DrawSubmission::GpuCulled) {
+                recordCulling(frameInfo);
+            }
+        }
+        recordStats.milliseconds += std::chrono::duration<double, std::chrono::milliseconds::period>(
+                std::chrono::high_resolution_clock::now() - recordStart).count();
+    }
+
+    void SimpleRenderSystem::renderGameObjects(FrameInfo &frameInfo) {
+        auto recordStart = std::chrono::high_resolution_clock::now();
+        if (batches.empty()) return;
+
+        // descriptor sets come from the cache, which is not thread safe, so they are resolved
+        // before recording fans out
+        auto &manager = frameInfo.gameObjectManager;
+        auto objectBufferInfo = manager.getObjectBufferInfo(frameInfo.frameIndex);
+        auto &instanceBuffer = drawSubmission == DrawSubmission::GpuCulled
+                               ? visibleInstanceBuffers[frameInfo.frameIndex]
+                               : instanceBuffers[frameInfo.frameIndex];
+        auto instanceBufferInfo = instanceBuffer->descriptorInfo();
+        VkDescriptorSet objectDescriptorSet;
+        DescriptorWriter(*objectSetLayout, frameInfo.descriptorCache)
+                .writeBuffer(0, &objectBufferInfo)
+                .writeBuffer(1, &instanceBufferInfo)
+                .build(objectDescriptorSet);
+        // the texture table holds every texture, so one bind covers all batches
+        drawDescriptorSets = {
+                frameInfo.globalDescriptorSet,
+                objectDescriptorSet,
+                manager.getTextureTable().getDescriptorSet(),
+                frameInfo.lightDescriptorSet};
+
+        // with the pre-pass every draw is recorded twice, first depth only
+        const uint32_t passCount = prepassActive ? 2 : 1;
+
+        auto &renderer = frameInfo.renderer;
+        auto batchCount = static_cast<uint32_t>(batches.size());
+        if (drawSubmission == DrawSubmission::Direct) {
+            // one secondary command buffer per slot and pass, each drawing a contiguous range of
+            // batches. All pre-pass buffers execute before the first shading buffer
+            uint32_t slotCount = std::min(
+                    renderer.getRecordingSlotCount(),
+                    (batchCount + RECORD_BATCH_SIZE - 1) / RECORD_BATCH_SIZE);
+            secondaryCommandBuffers.resize(slotCount * passCount);
+            slotDrawCalls.assign(slotCount, 0);
+            frameInfo.jobSystem.parallelFor(0, slotCount, 1, [&](uint32_t firstSlot, uint32_t lastSlot) {
+                for (uint32_t slot = firstSlot; slot < lastSlot; slot++) {
+                    auto firstBatch = static_cast<uint32_t>(uint64_t{batchCount} * slot / slotCount);
+                    auto lastBatch = static_cast<uint32_t>(uint64_t{batchCount} * (slot + 1) / slotCount);
+                    for (uint32_t pass = 0; pass < passCount; pass++) {
+                        bool isPrepass = pass + 1 < passCount;
+                        VkCommandBuffer commandBuffer = renderer.beginSecondaryCommandBuffer(slot);
+                        bindFrameState(
+                                frameInfo,
+                                commandBuffer,
+                                isPrepass ? *depthPrepassPipeline : *shadingPipeline,
+                                drawDescriptorSets);
+                        slotDrawCalls[slot] += drawDirect(frameInfo, commandBuffer, firstBatch, lastBatch);
+                        OceanRenderer::endSecondaryCommandBuffer(commandBuffer);
+                        secondaryCommandBuffers[pass * slotCount + slot] = commandBuffer;
+                    }
+                }
+            });
+            recordStats.drawCalls = 0;
+            for (uint32_t drawCalls: slotDrawCalls) {
+                recordStats.drawCalls += drawCalls;
+            }
+        } else {
+            recordStats.drawCalls = 0;
+            secondaryCommandBuffers.assign(1, recordIndirectDraws(frameInfo, 0));
+        }
+
+        vkCmdExecuteCommands(
+                frameInfo.commandBuffer,
+                static_cast<uint32_t>(secondaryCommandBuffers.size()),
+                secondaryCommandBuffers.data());
+
+        recordStats.milliseconds += std::chrono::duration<double, std::chrono::milliseconds::period>(
+                std::chrono::high_resolution_clock::now() - recordStart).count();
+        recordStats.frames++;
+    }
+
+    void SimpleRenderSystem::renderDisoccluded(FrameInfo &frameInfo) {
+        assert(occlusionActive && "Cannot render disoccluded objects when occlusion culling is not active");
+        auto recordStart = std::chrono::high_resolution_clock::now();
+
+        VkCommandBuffer commandBuffer = recordIndirectDraws(frameInfo, static_cast<uint32_t>(batches.size()));
+        vkCmdExecuteCommands(frameInfo.commandBuffer, 1, &commandBuffer);
+
+        recordStats.milliseconds += std::chrono::duration<double, std::chrono::milliseconds::period>(
+                std::chrono::high_resolution_clock::now() - recordStart).count();
+    }
+
+    VkCommandBuffer SimpleRenderSystem::recordIndirectDraws(FrameInfo &frameInfo, uint32_t firstCommand) {
+        // a handful of indirect draws, not worth splitting
+        VkCommandBuffer commandBuffer = frameInfo.renderer.beginSecondaryCommandBuffer(0);
+        if (prepassActive) {
+            bindFrameState(frameInfo, commandBuffer, *depthPrepassPipeline, drawDescriptorSets);
+            recordStats.drawCalls += drawIndirect(frameInfo, commandBuffer, firstCommand);
+        }
+        bindFrameState(frameInfo, commandBuffer, *shadingPipeline, drawDescriptorSets);
+        recordStats.drawCalls += drawIndirect(frameInfo, commandBuffer, firstCommand);
+        OceanRenderer::endSecondaryCommandBuffer(commandBuffer);
+        return commandBuffer;
+    }
+
+    void SimpleRenderSystem::bindFrameState(
+            FrameInfo &frameInfo,
+            VkCommandBuffer commandBuffer,
+            Pipeline &framePipeline,
+            const std::array<VkDescriptorSet, 4> &descriptorSets) const {
+        framePipeline.bind(commandBuffer);
+        vkCmdBindDescriptorSets(
+                commandBuffer,
                 VK_PIPELINE_BIND_POINT_GRAPHICS,
                 pipelineLayout,
                 0,
-                1,
-                &frameInfo.globalDescriptorSet,
+                static_cast<uint32_t>(descriptorSets.size()),
+                descriptorSets.data(),
                 0,
                 nullptr);
 
-        for (auto &kv: frameInfo.gameObjects) {
-            auto &obj = kv.second;
-
-            if (obj.model == nullptr) continue;
-
-            // writing descriptor set each frame can slow performance
-            // would be more efficient to implement some sort of caching
-            auto bufferInfo = obj.getBufferInfo(frameInfo.frameIndex);
-            auto imageInfo = obj.diffuseMap->getImageInfo();
-            VkDescriptorSet gameObjectDescriptorSet;
-            DescriptorWriter(*renderSystemLayout, frameInfo.frameDescriptorPool)
-                    .writeBuffer(0, &bufferInfo)
-                    .writeImage(1, &imageInfo)
-                    .build(gameObjectDescriptorSet);
-
-            vkCmdBindDescriptorSets(
-                    frameInfo.commandBuffer,
-                    VK_PIPELINE_BIND_POINT_GRAPHICS,
-                    pipelineLayout,
-                    1,  // starting set (0 is the globalDescriptorSet, 1 is the set specific to this system)
-                    1,  // set count
-                    &gameObjectDescriptorSet,
-                    0,
-                    nullptr);
-
-            SimplePushConstantData push{};
-            push.modelMatrix = obj.transform.mat4();
-            push.normalMatrix = obj.transform.normalMatrix();
-
-            vkCmdPushConstants(
-                    frameInfo.commandBuffer,
-                    pipelineLayout,
-                    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                    0,
-                    sizeof(SimplePushConstantData),
-                    &push);
-            obj.model->bind(frameInfo.commandBuffer);
-            obj.model->draw(frameInfo.commandBuffer);
+        // every model lives in the mesh pool, one bind covers all batches
+        frameInfo.gameObjectManager.getMeshPool().bind(commandBuffer);
+    }
+
+    uint32_t SimpleRenderSystem::drawDirect(
+            FrameInfo &frameInfo, VkCommandBuffer commandBuffer, uint32_t firstBatch, uint32_t lastBatch) const {
+        const MeshPool &meshPool = frameInfo.gameObjectManager.getMeshPool();
+        for (uint32_t i = firstBatch; i < lastBatch; i++) {
+            const auto &batch = batches[i];
+            const auto &mesh = meshPool.getMesh(batch.model);
+            vkCmdDrawIndexed(
+                    commandBuffer,
+                    mesh.indexCount,
+                    batch.instanceCount,
+                    mesh.firstIndex,
+                    mesh.vertexOffset,
+                    batch.firstInstance);
+        }
+        return lastBatch - firstBatch;
+    }
+
+    uint32_t SimpleRenderSystem::drawIndirect(
+            FrameInfo &frameInfo, VkCommandBuffer commandBuffer, uint32_t firstCommand) const {
+        const auto &indirectBuffer = indirectBuffers[frameInfo.frameIndex];
+
+        // without multiDrawIndirect every command needs its own call, still without any
+        // per draw arguments recorded on the host
+        const uint32_t maxDrawCount = device.enabledFeatures.multiDrawIndirect
+                                      ? device.properties.limits.maxDrawIndirectCount
+                                      : 1;
+        constexpr auto stride = static_cast<uint32_t>(sizeof(VkDrawIndexedIndirectCommand));
+        uint32_t drawCalls = 0;
+        auto batchCount = static_cast<uint32_t>(batches.size());
+        for (uint32_t first = 0; first < batchCount; first += maxDrawCount) {
+            uint32_t drawCount = std::min(maxDrawCount, batchCount - first);
+            vkCmdDrawIndexedIndirect(
+                    commandBuffer, indirectBuffer->getBuffer(), (firstCommand + first) * stride, drawCount, stride);
+            drawCalls++;
         }
+        return drawCalls;
     }
 
 }  // namespace Ocean
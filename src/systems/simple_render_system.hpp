@@ -1,21 +1,59 @@
 #pragma once
 
 #include "camera.hpp"
+#include "depth_pyramid.hpp"
 #include "vulkan/device.hpp"
 #include "frame_info.hpp"
 #include "game_object.hpp"
+#include "render_queue.hpp"
+#include "vulkan/buffer.hpp"
 #include "vulkan/pipeline.hpp"
 #include "vulkan/descriptors.hpp"
+#include "vulkan/swap_chain.hpp"
 
 // std
+#include <array>
 #include <memory>
 #include <vector>
 
 namespace Ocean {
     class SimpleRenderSystem {
     public:
+        enum class DrawSubmission {
+            Direct,    // one vkCmdDrawIndexed per batch
+            Indirect,  // batches written to an indirect buffer, drawn with as few vkCmdDrawIndexedIndirect as possible
+            GpuCulled  // like Indirect, but a compute pass frustum culls and writes the instance counts
+        };
+
+        // CPU cost of prepareFrame and renderGameObjects, accumulated until reset
+        struct RecordStats {
+            double milliseconds = 0.0;
+            uint32_t frames = 0;
+            uint32_t drawCalls = 0;
+            // visible and occlusion culled instances read back from the GPU, MAX_FRAMES_IN_FLIGHT
+            // frames behind
+            uint32_t gpuVisibleInstances = 0;
+            uint32_t gpuOccludedInstances = 0;
+        };
+
+        // CPU frustum culling of the last frame. GPU culled frames skip it and hand every object
+        // with a model to the GPU, they count as drawn without being tested
+        struct CullStats {
+            uint32_t tested = 0;
+            uint32_t culled = 0;
+            uint32_t drawn = 0;
+        };
+
+        // textureSetLayout is the layout of the texture table, bound as set 2, lightSetLayout the
+        // layout of the light clusters, bound as set 3. Deferred frames draw into the G-buffer
+        // subpass of deferredRenderPass
         SimpleRenderSystem(
-                Device &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+                Device &device,
+                VkRenderPass renderPass,
+                VkRenderPass deferredRenderPass,
+                VkDescriptorSetLayout globalSetLayout,
+                VkDescriptorSetLayout textureSetLayout,
+                VkDescriptorSetLayout lightSetLayout);
 
         ~SimpleRenderSystem();
 
@@ -23,18 +61,173 @@ namespace Ocean {
 
         SimpleRenderSystem &operator=(const SimpleRenderSystem &) = delete;
 
+        // builds this frame's batches and records the culling dispatch, must be called before the
+        // render pass begins. Picks the pipelines for frameInfo.shadingPath
+        void prepareFrame(FrameInfo &frameInfo);
+
+        // draws everything prepareFrame found visible, with occlusion culling only what phase 1
+        // of the culling found visible
         void renderGameObjects(FrameInfo &frameInfo);
 
+        // builds the depth pyramid from the depth drawn so far and records phase 2 of the culling,
+        // called between the First and Second swap chain render pass
+        void cullOccluded(FrameInfo &frameInfo);
+
+        // draws what phase 2 found visible, called in the Second swap chain render pass
+        void renderDisoccluded(FrameInfo &frameInfo);
+
+        // indirect submissions need drawIndirectFirstInstance, without it draws stay direct
+        void setDrawSubmission(DrawSubmission submission);
+
+        [[nodiscard]] DrawSubmission getDrawSubmission() const { return drawSubmission; }
+
+        // draws every batch depth only first, then shades with depthCompareOp EQUAL so every
+        // visible pixel is lit once. Forward shading only
+        void setDepthPrepass(bool enabled) { depthPrepass = enabled; }
+
+        [[nodiscard]] bool isDepthPrepassEnabled() const { return depthPrepass; }
+
+        // tests GPU culled objects against a depth pyramid of the previous frame, objects it hides
+        // are retested against the current frame's depth before they are dropped. Forward shading
+        // only, the deferred render pass can't be split
+        void setOcclusionCulling(bool enabled) { occlusionCulling = enabled; }
+
+        [[nodiscard]] bool isOcclusionCullingEnabled() const { return occlusionCulling; }
+
+        // set by prepareFrame, if true the frame has to split its render pass around cullOccluded
+        [[nodiscard]] bool isOcclusionCullingActive() const { return occlusionActive; }
+
+        [[nodiscard]] const RecordStats &getRecordStats() const { return recordStats; }
+
+        void resetRecordStats() { recordStats = RecordStats{}; }
+
+        [[nodiscard]] const CullStats &getCullStats() const { return cullStats; }
+
     private:
-        void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
+        static constexpr uint32_t INITIAL_INSTANCE_CAPACITY = 1024;
+        // smallest number of bounding spheres tested by one job
+        static constexpr uint32_t CULL_BATCH_SIZE = 4096;
+        // smallest number of direct draw batches recorded into one secondary command buffer
+        static constexpr uint32_t RECORD_BATCH_SIZE = 256;
+
+        // matches InstanceData in basic_shader.vert
+        struct InstanceData {
+            uint32_t objectIndex;  // into the game object buffer
+            uint32_t materialIndex;  // into the texture table
+        };
 
-        void createPipeline(VkRenderPass renderPass);
+        // matches CullInstance in cull.comp
+        struct CullInstance {
+            uint32_t objectIndex;
+            uint32_t materialIndex;
+            uint32_t batchIndex;  // the indirect command counting this instance
+        };
+
+        // matches Push in cull.comp
+        struct CullPush {
+            glm::mat4 occlusionViewProjection;
+            uint32_t instanceCount;
+            uint32_t batchCount;
+            uint32_t phase;  // 1 or 2
+            uint32_t occlusionEnabled;
+        };
+
+        // objects sharing a model and texture, drawn with one instanced draw
+        struct InstanceBatch {
+            ModelHandle model;
+            TextureHandle texture;
+            uint32_t firstInstance;
+            uint32_t instanceCount;
+        };
+
+        void createPipelineLayout(
+                VkDescriptorSetLayout globalSetLayout,
+                VkDescriptorSetLayout textureSetLayout,
+                VkDescriptorSetLayout lightSetLayout);
+
+        void createPipelines(VkRenderPass renderPass, VkRenderPass deferredRenderPass);
+
+        void createCullPipeline(VkDescriptorSetLayout globalSetLayout);
+
+        // tests the bounding sphere of every object against the camera frustum into visibility
+        void cullObjects(FrameInfo &frameInfo);
+
+        // groups visible objects into batches and uploads their instance data
+        void buildBatches(FrameInfo &frameInfo);
+
+        // one command per batch, GPU culled commands start without instances
+        void writeIndirectCommands(FrameInfo &frameInfo);
+
+        // resolves the culling descriptor set and records phase 1
+        void recordCulling(FrameInfo &frameInfo);
+
+        // binds and dispatches cull.comp, then makes its results visible to the draws
+        void dispatchCulling(
+                FrameInfo &frameInfo, uint32_t phase, const glm::mat4 &occlusionViewProjection, bool occlusionEnabled);
+
+        // binds the pipeline, descriptor sets 0-3 and the mesh pool
+        void bindFrameState(
+                FrameInfo &frameInfo,
+                VkCommandBuffer commandBuffer,
+                Pipeline &framePipeline,
+                const std::array<VkDescriptorSet, 4> &descriptorSets) const;
+
+        // draws batches [firstBatch, lastBatch), called from worker threads, returns the draw calls
+        uint32_t drawDirect(
+                FrameInfo &frameInfo, VkCommandBuffer commandBuffer, uint32_t firstBatch, uint32_t lastBatch) const;
+
+        // draws the batches with the indirect commands from firstCommand on, returns the draw calls
+        uint32_t drawIndirect(FrameInfo &frameInfo, VkCommandBuffer commandBuffer, uint32_t firstCommand) const;
+
+        // records every batch through indirect commands from firstCommand on into one secondary
+        // command buffer, with the pre-pass if enabled
+        VkCommandBuffer recordIndirectDraws(FrameInfo &frameInfo, uint32_t firstCommand);
 
         Device &device;
 
         std::unique_ptr<Pipeline> pipeline;
+        // depth only, and the shading pipeline testing against its depth
+        std::unique_ptr<Pipeline> depthPrepassPipeline;
+        std::unique_ptr<Pipeline> depthEqualPipeline;
+        // writes albedo and normal in the G-buffer subpass
+        std::unique_ptr<Pipeline> gBufferPipeline;
         VkPipelineLayout pipelineLayout{};
 
-        std::unique_ptr<DescriptorSetLayout> renderSystemLayout;
+        std::unique_ptr<DescriptorSetLayout> objectSetLayout;
+
+        std::unique_ptr<ComputePipeline> cullPipeline;
+        VkPipelineLayout cullPipelineLayout{};
+        std::unique_ptr<DescriptorSetLayout> cullSetLayout;
+        DepthPyramid depthPyramid;
+
+        DrawSubmission drawSubmission = DrawSubmission::GpuCulled;
+        bool depthPrepass = false;
+        bool occlusionCulling = true;
+        bool occlusionActive = false;  // this frame
+        bool prepassActive = false;  // this frame
+        Pipeline *shadingPipeline = nullptr;  // this frame
+        RecordStats recordStats{};
+        CullStats cullStats{};
+
+        std::array<std::unique_ptr<OceanBuffer>, SwapChain::MAX_FRAMES_IN_FLIGHT> instanceBuffers;
+        std::array<std::unique_ptr<OceanBuffer>, SwapChain::MAX_FRAMES_IN_FLIGHT> indirectBuffers;
+        // GPU culling inputs and outputs, the visible instances are written by cull.comp only
+        std::array<std::unique_ptr<OceanBuffer>, SwapChain::MAX_FRAMES_IN_FLIGHT> cullInstanceBuffers;
+        std::array<std::unique_ptr<OceanBuffer>, SwapChain::MAX_FRAMES_IN_FLIGHT> visibleInstanceBuffers;
+        std::array<std::unique_ptr<OceanBuffer>, SwapChain::MAX_FRAMES_IN_FLIGHT> countBuffers;
+        std::array<std::unique_ptr<OceanBuffer>, SwapChain::MAX_FRAMES_IN_FLIGHT> recheckBuffers;
+        std::array<bool, SwapChain::MAX_FRAMES_IN_FLIGHT> countPending{};  // countBuffers holds a result
+        // resolved once per frame, used again by the second culling and draw phase
+        VkDescriptorSet cullDescriptorSet{};
+        std::array<VkDescriptorSet, 4> drawDescriptorSets{};
+        // scratch, kept to reuse their capacity
+        std::vector<uint8_t> visibility;  // per object, 1 if it passed cullObjects
+        RenderQueue renderQueue;  // object indices keyed by pass, pipeline, texture, model and depth
+        std::vector<InstanceData> instances;
+        std::vector<CullInstance> cullInstances;
+        std::vector<InstanceBatch> batches;
+        std::vector<VkDrawIndexedIndirectCommand> indirectCommands;
+        std::vector<VkCommandBuffer> secondaryCommandBuffers;
+        std::vector<uint32_t> slotDrawCalls;  // written by the recording jobs of each slot
     };
 }  // namespace Ocean
@@ -103,10 +103,18 @@ namespace Ocean {
     }
 
     Texture::~Texture() {
-        vkDestroySampler(mDevice.device(), mTextureSampler, nullptr);
-        vkDestroyImageView(mDevice.device(), mTextureImageView, nullptr);
-        vkDestroyImage(mDevice.device(), mTextureImage, nullptr);
-        vkFreeMemory(mDevice.device(), mTextureImageMemory, nullptr);
+        // descriptor sets of frames in flight may still sample this image
+        mDevice.deferDestruction(
+                [device = mDevice.device(),
+                 sampler = mTextureSampler,
+                 imageView = mTextureImageView,
+                 image = mTextureImage,
+                 imageMemory = mTextureImageMemory]() {
+                    vkDestroySampler(device, sampler, nullptr);
+                    vkDestroyImageView(device, imageView, nullptr);
+                    vkDestroyImage(device, image, nullptr);
+                    vkFreeMemory(device, imageMemory, nullptr);
+                });
     }
 
     std::unique_ptr<Texture> Texture::createTextureFromFile(
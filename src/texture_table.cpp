@@ -0,0 +1,47 @@
+#include "texture_table.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+namespace Ocean {
+
+    TextureTable::TextureTable(Device &device)
+            : device{device},
+              maxTextures{std::min(
+                      MAX_TEXTURES,
+                      device.descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages)} {
+        pool = DescriptorPool::Builder(device)
+                .setMaxSets(1)
+                .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxTextures)
+                .build();
+        setLayout = DescriptorSetLayout::Builder(device)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, maxTextures)
+                .setBindingFlags(
+                        0, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT)
+                .build();
+        if (!pool->allocateDescriptor(setLayout->getDescriptorSetLayout(), descriptorSet)) {
+            throw std::runtime_error("failed to allocate texture table descriptor set!");
+        }
+    }
+
+    uint32_t TextureTable::add(const Texture &texture) {
+        if (textureCount == maxTextures) {
+            throw std::runtime_error("texture table is full");
+        }
+
+        VkDescriptorImageInfo imageInfo = texture.getImageInfo();
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = descriptorSet;
+        write.dstBinding = 0;
+        write.dstArrayElement = textureCount;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.descriptorCount = 1;
+        write.pImageInfo = &imageInfo;
+        vkUpdateDescriptorSets(device.device(), 1, &write, 0, nullptr);
+        return textureCount++;
+    }
+
+}  // namespace Ocean
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "texture.hpp"
+#include "vulkan/descriptors.hpp"
+#include "vulkan/device.hpp"
+
+// std
+#include <memory>
+
+namespace Ocean {
+
+    // One descriptor set holding every registered texture in a partially bound array, so shaders
+    // pick their texture by index and all geometry can be drawn after a single bind. New textures
+    // are written with update after bind, the set stays valid while frames using it are in flight.
+    class TextureTable {
+    public:
+        static constexpr uint32_t MAX_TEXTURES = 4096;
+
+        explicit TextureTable(Device &device);
+
+        TextureTable(const TextureTable &) = delete;
+
+        TextureTable &operator=(const TextureTable &) = delete;
+
+        // writes the texture into the next free element, returns its index
+        uint32_t add(const Texture &texture);
+
+        [[nodiscard]] VkDescriptorSetLayout getSetLayout() const { return setLayout->getDescriptorSetLayout(); }
+
+        [[nodiscard]] VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+
+        [[nodiscard]] uint32_t size() const { return textureCount; }
+
+        [[nodiscard]] uint32_t capacity() const { return maxTextures; }
+
+    private:
+        Device &device;
+        uint32_t maxTextures;
+        std::unique_ptr<DescriptorPool> pool;
+        std::unique_ptr<DescriptorSetLayout> setLayout;
+        VkDescriptorSet descriptorSet{};
+        uint32_t textureCount = 0;
+    };
+
+}  // namespace Ocean
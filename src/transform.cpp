@@ -0,0 +1,212 @@
+#include "transform.hpp"
+
+#include "simd_lanes.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+
+namespace Ocean {
+
+    glm::mat4 TransformComponent::mat4() const {
+        const float c3 = glm::cos(rotation.z);
+        const float s3 = glm::sin(rotation.z);
+        const float c2 = glm::cos(rotation.x);
+        const float s2 = glm::sin(rotation.x);
+        const float c1 = glm::cos(rotation.y);
+        const float s1 = glm::sin(rotation.y);
+        return glm::mat4{
+                {
+                        scale.x * (c1 * c3 + s1 * s2 * s3),
+                        scale.x * (c2 * s3),
+                        scale.x * (c1 * s2 * s3 - c3 * s1),
+                        0.0f,
+                },
+                {
+                        scale.y * (c3 * s1 * s2 - c1 * s3),
+                        scale.y * (c2 * c3),
+                        scale.y * (c1 * c3 * s2 + s1 * s3),
+                        0.0f,
+                },
+                {
+                        scale.z * (c2 * s1),
+                        scale.z * (-s2),
+                        scale.z * (c1 * c2),
+                        0.0f,
+                },
+                {
+                        translation.x,
+                        translation.y,
+                        translation.z,
+                        1.0f
+                }
+        };
+    }
+
+    glm::mat3 TransformComponent::normalMatrix() const {
+        const float c3 = glm::cos(rotation.z);
+        const float s3 = glm::sin(rotation.z);
+        const float c2 = glm::cos(rotation.x);
+        const float s2 = glm::sin(rotation.x);
+        const float c1 = glm::cos(rotation.y);
+        const float s1 = glm::sin(rotation.y);
+        const glm::vec3 invScale = 1.0f / scale;
+
+        return glm::mat3{
+                {
+                        invScale.x * (c1 * c3 + s1 * s2 * s3),
+                        invScale.x * (c2 * s3),
+                        invScale.x * (c1 * s2 * s3 - c3 * s1),
+                },
+                {
+                        invScale.y * (c3 * s1 * s2 - c1 * s3),
+                        invScale.y * (c2 * c3),
+                        invScale.y * (c1 * c3 * s2 + s1 * s3),
+                },
+                {
+                        invScale.z * (c2 * s1),
+                        invScale.z * (-s2),
+                        invScale.z * (c1 * c2),
+                },
+        };
+    }
+
+    namespace {
+
+        // Cephes style sincos: reduce x by multiples of pi/2 (split in three parts so the reduction
+        // stays exact for the angles we care about), evaluate minimax polynomials on
+        // [-pi/4, pi/4] and pick/negate the results by quadrant. Max error is a few ulp.
+        template<typename L>
+        void sincos(typename L::F x, typename L::F &sinOut, typename L::F &cosOut) {
+            using F = typename L::F;
+            auto quadrant = L::roundToInt(L::mul(x, L::set1(0.636619772367581343f)));  // 2 / pi
+            F q = L::toFloat(quadrant);
+            F r = L::sub(x, L::mul(q, L::set1(1.5703125f)));
+            r = L::sub(r, L::mul(q, L::set1(4.837512969970703125e-4f)));
+            r = L::sub(r, L::mul(q, L::set1(7.54978995489188216e-8f)));
+            F z = L::mul(r, r);
+
+            F sinPoly = L::add(L::set1(8.3321608736e-3f), L::mul(z, L::set1(-1.9515295891e-4f)));
+            sinPoly = L::add(L::set1(-1.6666654611e-1f), L::mul(z, sinPoly));
+            sinPoly = L::add(r, L::mul(L::mul(r, z), sinPoly));
+
+            F cosPoly = L::add(L::set1(-1.388731625493765e-3f), L::mul(z, L::set1(2.443315711809948e-5f)));
+            cosPoly = L::add(L::set1(4.166664568298827e-2f), L::mul(z, cosPoly));
+            cosPoly = L::add(L::sub(L::set1(1.f), L::mul(L::set1(0.5f), z)), L::mul(L::mul(z, z), cosPoly));
+
+            // odd quadrants swap sin and cos, quadrants 2,3 negate sin and 1,2 negate cos
+            F s = L::selectBit(quadrant, 1, sinPoly, cosPoly);
+            F c = L::selectBit(quadrant, 1, cosPoly, sinPoly);
+            sinOut = L::selectBit(quadrant, 2, s, L::negate(s));
+            cosOut = L::selectBit(L::addInt(quadrant, 1), 2, c, L::negate(c));
+        }
+
+        template<typename L>
+        void computeTransformsImpl(
+                const glm::vec3 *translations,
+                const glm::vec3 *rotations,
+                const glm::vec3 *scales,
+                const uint32_t *indices,
+                size_t count,
+                GameObjectBufferData *out) {
+            using F = typename L::F;
+            constexpr int W = L::width;
+
+            // components arrive as xyz triples, gather them into one lane per object
+            alignas(32) float in[6][W];
+            // rotation part of the model matrix followed by the normal matrix, 9 values each
+            alignas(32) float result[18][W];
+
+            for (size_t base = 0; base < count; base += W) {
+                const int lanes = static_cast<int>(std::min<size_t>(W, count - base));
+                for (int lane = 0; lane < W; lane++) {
+                    // repeat the last object to fill the tail, those lanes are never written back
+                    uint32_t index = indices[base + std::min(lane, lanes - 1)];
+                    in[0][lane] = rotations[index].x;
+                    in[1][lane] = rotations[index].y;
+                    in[2][lane] = rotations[index].z;
+                    in[3][lane] = scales[index].x;
+                    in[4][lane] = scales[index].y;
+                    in[5][lane] = scales[index].z;
+                }
+
+                F s1, c1, s2, c2, s3, c3;
+                sincos<L>(L::load(in[1]), s1, c1);
+                sincos<L>(L::load(in[0]), s2, c2);
+                sincos<L>(L::load(in[2]), s3, c3);
+
+                // rotation matrix Ry * Rx * Rz, see TransformComponent::mat4
+                F rotation[9] = {
+                        L::add(L::mul(c1, c3), L::mul(L::mul(s1, s2), s3)),
+                        L::mul(c2, s3),
+                        L::sub(L::mul(L::mul(c1, s2), s3), L::mul(c3, s1)),
+                        L::sub(L::mul(L::mul(c3, s1), s2), L::mul(c1, s3)),
+                        L::mul(c2, c3),
+                        L::add(L::mul(L::mul(c1, c3), s2), L::mul(s1, s3)),
+                        L::mul(c2, s1),
+                        L::negate(s2),
+                        L::mul(c1, c2),
+                };
+
+                F one = L::set1(1.f);
+                for (int column = 0; column < 3; column++) {
+                    F scale = L::load(in[3 + column]);
+                    F invScale = L::div(one, scale);
+                    for (int row = 0; row < 3; row++) {
+                        L::store(result[column * 3 + row], L::mul(scale, rotation[column * 3 + row]));
+                        L::store(result[9 + column * 3 + row], L::mul(invScale, rotation[column * 3 + row]));
+                    }
+                }
+
+                for (int lane = 0; lane < lanes; lane++) {
+                    uint32_t index = indices[base + lane];
+                    auto &data = out[index];
+                    for (int column = 0; column < 3; column++) {
+                        for (int row = 0; row < 3; row++) {
+                            data.modelMatrix[column][row] = result[column * 3 + row][lane];
+                            data.normalMatrix[column][row] = result[9 + column * 3 + row][lane];
+                        }
+                        data.modelMatrix[column][3] = 0.f;
+                        data.normalMatrix[column][3] = 0.f;
+                    }
+                    data.modelMatrix[3] = glm::vec4{translations[index], 1.f};
+                    data.normalMatrix[3] = glm::vec4{0.f, 0.f, 0.f, 1.f};
+                }
+            }
+        }
+
+    }  // namespace
+
+    void computeTransforms(
+            const glm::vec3 *translations,
+            const glm::vec3 *rotations,
+            const glm::vec3 *scales,
+            const uint32_t *indices,
+            size_t count,
+            GameObjectBufferData *out) {
+#ifdef OCEAN_SIMD_SCALAR_ONLY
+        computeTransformsImpl<ScalarLanes>(translations, rotations, scales, indices, count, out);
+#else
+        computeTransformsImpl<SimdLanes>(translations, rotations, scales, indices, count, out);
+#endif
+    }
+
+    void computeTransformsScalar(
+            const glm::vec3 *translations,
+            const glm::vec3 *rotations,
+            const glm::vec3 *scales,
+            const uint32_t *indices,
+            size_t count,
+            GameObjectBufferData *out) {
+        computeTransformsImpl<ScalarLanes>(translations, rotations, scales, indices, count, out);
+    }
+
+    const char *transformKernelName() {
+#ifdef OCEAN_SIMD_SCALAR_ONLY
+        return ScalarLanes::name;
+#else
+        return SimdLanes::name;
+#endif
+    }
+
+}  // namespace Ocean
@@ -0,0 +1,54 @@
+#pragma once
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+
+namespace Ocean {
+
+    struct TransformComponent {
+        glm::vec3 translation{};
+        glm::vec3 scale{1.f, 1.f, 1.f};
+        glm::vec3 rotation{};
+
+        // Matrix corrsponds to Translate * Ry * Rx * Rz * Scale
+        // Rotations correspond to Tait-bryan angles of Y(1), X(2), Z(3)
+        // https://en.wikipedia.org/wiki/Euler_angles#Rotation_matrix
+        glm::mat4 mat4() const;
+
+        glm::mat3 normalMatrix() const;
+    };
+
+    struct GameObjectBufferData {
+        glm::mat4 modelMatrix{1.f};
+        glm::mat4 normalMatrix{1.f};
+    };
+
+    // Batched equivalent of TransformComponent::mat4() and normalMatrix(). For every i < count,
+    // reads the transform at indices[i] from the component arrays and writes both matrices to
+    // out[indices[i]]. Sines and cosines are evaluated several objects at a time using the widest
+    // SIMD instruction set the translation unit was compiled for.
+    void computeTransforms(
+            const glm::vec3 *translations,
+            const glm::vec3 *rotations,
+            const glm::vec3 *scales,
+            const uint32_t *indices,
+            size_t count,
+            GameObjectBufferData *out);
+
+    // same kernel restricted to one object per step, for platforms without SIMD and for comparison
+    void computeTransformsScalar(
+            const glm::vec3 *translations,
+            const glm::vec3 *rotations,
+            const glm::vec3 *scales,
+            const uint32_t *indices,
+            size_t count,
+            GameObjectBufferData *out);
+
+    // name of the instruction set computeTransforms was built with, e.g. "AVX2"
+    const char *transformKernelName();
+
+}  // namespace Ocean
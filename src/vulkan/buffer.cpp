@@ -8,6 +8,7 @@
 #include "buffer.hpp"
 
 // std
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
@@ -29,6 +30,27 @@ namespace Ocean {
         return instanceSize;
     }
 
+    void OceanBuffer::reserve(
+            Device &device,
+            std::unique_ptr<OceanBuffer> &buffer,
+            VkDeviceSize elementSize,
+            uint32_t elementCount,
+            VkBufferUsageFlags usage,
+            VkMemoryPropertyFlags memoryProperties,
+            VkDeviceSize minOffsetAlignment) {
+        uint32_t capacity = buffer ? buffer->getInstanceCount() : std::max(elementCount, 1u);
+        if (buffer && elementCount <= capacity) return;
+
+        while (capacity < elementCount) {
+            capacity *= 2;
+        }
+        buffer = std::make_unique<OceanBuffer>(
+                device, elementSize, capacity, usage, memoryProperties, minOffsetAlignment);
+        if (memoryProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            buffer->map();
+        }
+    }
+
     OceanBuffer::OceanBuffer(
             Device &device,
             VkDeviceSize instanceSize,
@@ -48,8 +70,11 @@ namespace Ocean {
 
     OceanBuffer::~OceanBuffer() {
         unmap();
-        vkDestroyBuffer(device.device(), buffer, nullptr);
-        vkFreeMemory(device.device(), memory, nullptr);
+        // frames in flight may still read from this buffer, hand it to the device's deletion queue
+        device.deferDestruction([vkDevice = device.device(), buffer = buffer, memory = memory]() {
+            vkDestroyBuffer(vkDevice, buffer, nullptr);
+            vkFreeMemory(vkDevice, memory, nullptr);
+        });
     }
 
 /**
@@ -180,6 +205,48 @@ namespace Ocean {
         return flush(alignmentSize, index * alignmentSize);
     }
 
+/**
+ * Flush every instance in sortedIndices with a single call, adjacent indices are merged into one
+ * memory range. Ranges are widened to nonCoherentAtomSize, so instances don't need to be aligned
+ * to it
+ *
+ * @param sortedIndices Instance indices in ascending order, without duplicates
+ *
+ */
+    VkResult OceanBuffer::flushIndices(const std::vector<uint32_t> &sortedIndices) {
+        if (sortedIndices.empty()) return VK_SUCCESS;
+
+        const VkDeviceSize atomSize = device.properties.limits.nonCoherentAtomSize;
+        std::vector<VkMappedMemoryRange> mappedRanges;
+        size_t runStart = 0;
+        for (size_t i = 1; i <= sortedIndices.size(); i++) {
+            if (i < sortedIndices.size() && sortedIndices[i] == sortedIndices[i - 1] + 1) continue;
+
+            VkDeviceSize begin = sortedIndices[runStart] * alignmentSize / atomSize * atomSize;
+            VkDeviceSize end = (sortedIndices[i - 1] + 1) * alignmentSize;
+            end = (end + atomSize - 1) / atomSize * atomSize;
+            runStart = i;
+
+            // widened ranges of nearby runs can touch, merge them instead of overlapping
+            if (!mappedRanges.empty() && begin <= mappedRanges.back().offset + mappedRanges.back().size) {
+                mappedRanges.back().size = end - mappedRanges.back().offset;
+                continue;
+            }
+            VkMappedMemoryRange mappedRange = {};
+            mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            mappedRange.memory = memory;
+            mappedRange.offset = begin;
+            mappedRange.size = end - begin;
+            mappedRanges.push_back(mappedRange);
+        }
+        // a range may only run past the buffer if it reaches the end of the allocation
+        if (mappedRanges.back().offset + mappedRanges.back().size > bufferSize) {
+            mappedRanges.back().size = VK_WHOLE_SIZE;
+        }
+        return vkFlushMappedMemoryRanges(
+                device.device(), static_cast<uint32_t>(mappedRanges.size()), mappedRanges.data());
+    }
+
 /**
  * Create a buffer info descriptor
  *
@@ -2,6 +2,10 @@
 
 #include "device.hpp"
 
+// std
+#include <memory>
+#include <vector>
+
 namespace Ocean {
 
     class OceanBuffer {
@@ -20,6 +24,17 @@ namespace Ocean {
 
         OceanBuffer &operator=(const OceanBuffer &) = delete;
 
+        // buffers rewritten every frame grow by doubling, the old buffer's destructor defers the
+        // free until frames reading it have retired. Host visible buffers come back mapped
+        static void reserve(
+                Device &device,
+                std::unique_ptr<OceanBuffer> &buffer,
+                VkDeviceSize elementSize,
+                uint32_t elementCount,
+                VkBufferUsageFlags usage,
+                VkMemoryPropertyFlags memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                VkDeviceSize minOffsetAlignment = 1);
+
         VkResult map(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 
         void unmap();
@@ -36,6 +51,8 @@ namespace Ocean {
 
         VkResult flushIndex(int index);
 
+        VkResult flushIndices(const std::vector<uint32_t> &sortedIndices);
+
         VkDescriptorBufferInfo descriptorInfoForIndex(int index);
 
         VkResult invalidateIndex(int index);
@@ -48,7 +65,7 @@ namespace Ocean {
 
         [[nodiscard]] VkDeviceSize getInstanceSize() const { return instanceSize; }
 
-        [[nodiscard]] VkDeviceSize getAlignmentSize() const { return instanceSize; }
+        [[nodiscard]] VkDeviceSize getAlignmentSize() const { return alignmentSize; }
 
         [[nodiscard]] VkBufferUsageFlags getUsageFlags() const { return usageFlags; }
 
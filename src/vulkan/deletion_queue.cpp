@@ -0,0 +1,55 @@
+#include "deletion_queue.hpp"
+
+// std
+#include <cassert>
+#include <vector>
+
+namespace Ocean {
+
+    DeletionQueue::~DeletionQueue() {
+        assert(entries.empty() && "DeletionQueue destroyed with pending destroy callbacks");
+    }
+
+    void DeletionQueue::push(uint64_t frameNumber, std::function<void()> destroyFn) {
+        std::lock_guard<std::mutex> lock{mutex};
+        assert(
+                (entries.empty() || entries.back().frameNumber <= frameNumber) &&
+                "Resources must be retired in frame order");
+        entries.push_back({frameNumber, std::move(destroyFn)});
+    }
+
+    void DeletionQueue::flush(uint64_t completedFrameNumber) {
+        // pop under the lock but destroy outside of it, a destroy callback may release an object
+        // that retires further resources (e.g. a Model releasing its buffers)
+        std::vector<std::function<void()>> ready;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            while (!entries.empty() && entries.front().frameNumber <= completedFrameNumber) {
+                ready.push_back(std::move(entries.front().destroyFn));
+                entries.pop_front();
+            }
+        }
+        for (auto &destroyFn: ready) {
+            destroyFn();
+        }
+    }
+
+    void DeletionQueue::flushAll() {
+        while (size() > 0) {
+            std::deque<Entry> pending;
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                pending.swap(entries);
+            }
+            for (auto &entry: pending) {
+                entry.destroyFn();
+            }
+        }
+    }
+
+    size_t DeletionQueue::size() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return entries.size();
+    }
+
+}  // namespace Ocean
@@ -0,0 +1,44 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace Ocean {
+
+    // Holds destroy callbacks for GPU objects that may still be referenced by command buffers
+    // in flight. Each entry is tagged with the frame that was being recorded when it was retired
+    // and is only run once that frame is known to have finished on the GPU.
+    class DeletionQueue {
+    public:
+        DeletionQueue() = default;
+
+        ~DeletionQueue();
+
+        DeletionQueue(const DeletionQueue &) = delete;
+
+        DeletionQueue &operator=(const DeletionQueue &) = delete;
+
+        void push(uint64_t frameNumber, std::function<void()> destroyFn);
+
+        // runs every callback retired during or before completedFrameNumber
+        void flush(uint64_t completedFrameNumber);
+
+        // runs every pending callback, only valid once the device is idle
+        void flushAll();
+
+        [[nodiscard]] size_t size() const;
+
+    private:
+        struct Entry {
+            uint64_t frameNumber;
+            std::function<void()> destroyFn;
+        };
+
+        mutable std::mutex mutex;
+        std::deque<Entry> entries;  // frame numbers are non-decreasing front to back
+    };
+
+}  // namespace Ocean
@@ -1,7 +1,10 @@
 #include "descriptors.hpp"
 
+#include "utils.hpp"
+
 // std
 #include <cassert>
+#include <cstdint>
 #include <stdexcept>
 
 namespace Ocean {
@@ -23,23 +26,48 @@ namespace Ocean {
         return *this;
     }
 
+    DescriptorSetLayout::Builder &DescriptorSetLayout::Builder::setBindingFlags(
+            uint32_t binding, VkDescriptorBindingFlags flags) {
+        assert(bindings.count(binding) == 1 && "Binding has not been added");
+        bindingFlags[binding] = flags;
+        return *this;
+    }
+
     std::unique_ptr<DescriptorSetLayout> DescriptorSetLayout::Builder::build() const {
-        return std::make_unique<DescriptorSetLayout>(device, bindings);
+        return std::make_unique<DescriptorSetLayout>(device, bindings, bindingFlags);
     }
 
 // *************** Descriptor Set Layout *********************
 
     DescriptorSetLayout::DescriptorSetLayout(
-            Device &device, const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings)
+            Device &device,
+            const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings,
+            const std::unordered_map<uint32_t, VkDescriptorBindingFlags> &bindingFlags)
             : device{device}, bindings{bindings} {
         std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+        std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
         setLayoutBindings.reserve(bindings.size());
+        setLayoutBindingFlags.reserve(bindings.size());
+        VkDescriptorSetLayoutCreateFlags layoutFlags = 0;
         for (auto kv: bindings) {
             setLayoutBindings.push_back(kv.second);
+            auto flags = bindingFlags.find(kv.first);
+            setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
+            if (setLayoutBindingFlags.back() & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) {
+                layoutFlags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+            }
         }
 
+        // per binding flags, parallel to pBindings
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+        bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+
         VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
         descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        descriptorSetLayoutInfo.pNext = bindingFlags.empty() ? nullptr : &bindingFlagsInfo;
+        descriptorSetLayoutInfo.flags = layoutFlags;
         descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
         descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
 
@@ -135,7 +163,12 @@ namespace Ocean {
 // *************** Descriptor Writer *********************
 
     DescriptorWriter::DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorPool &pool)
-            : setLayout{setLayout}, pool{pool} {}
+            : setLayout{setLayout}, pool{pool}, writes{ownWrites} {}
+
+    DescriptorWriter::DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorSetCache &cache)
+            : setLayout{setLayout}, pool{*cache.pool}, cache{&cache}, writes{cache.writeScratch} {
+        writes.clear();
+    }
 
     DescriptorWriter &DescriptorWriter::writeBuffer(
             uint32_t binding, VkDescriptorBufferInfo *bufferInfo) {
@@ -180,6 +213,9 @@ namespace Ocean {
     }
 
     bool DescriptorWriter::build(VkDescriptorSet &set) {
+        if (cache != nullptr) {
+            return cache->acquire(setLayout, writes, set);
+        }
         bool success = pool.allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
         if (!success) {
             return false;
@@ -195,4 +231,95 @@ namespace Ocean {
         vkUpdateDescriptorSets(pool.oceanDevice.device(), writes.size(), writes.data(), 0, nullptr);
     }
 
+// *************** Descriptor Set Cache *********************
+
+    DescriptorSetCache::DescriptorSetCache(
+            Device &device, uint32_t framesInFlight, std::unique_ptr<DescriptorPool> pool)
+            : device{device},
+              framesInFlight{framesInFlight},
+              pool{std::move(pool)},
+              idleReleaseCount{device.getIdleReleaseCount()} {}
+
+    DescriptorSetCache::~DescriptorSetCache() = default;  // the pool frees every set
+
+    size_t DescriptorSetCache::KeyHash::operator()(const std::vector<uint64_t> &key) const {
+        size_t seed = 0;
+        for (uint64_t word: key) {
+            hashCombine(seed, word);
+        }
+        return seed;
+    }
+
+    void DescriptorSetCache::beginFrame() {
+        frameNumber++;
+        writeCount = 0;
+
+        // handles destroyed while the device was idle may already have been reused, and the idle
+        // device holds none of the sets
+        if (device.getIdleReleaseCount() != idleReleaseCount) {
+            idleReleaseCount = device.getIdleReleaseCount();
+            clear();
+            return;
+        }
+
+        // a set unused for framesInFlight frames is no longer referenced by any frame in flight
+        staleSets.clear();
+        for (auto it = sets.begin(); it != sets.end();) {
+            if (frameNumber - it->second.lastUsedFrame >= framesInFlight) {
+                staleSets.push_back(it->second.set);
+                it = sets.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (!staleSets.empty()) {
+            pool->freeDescriptors(staleSets);
+        }
+    }
+
+    void DescriptorSetCache::clear() {
+        // the cache owns its pool, resetting it frees every set at once
+        pool->resetPool();
+        sets.clear();
+    }
+
+    bool DescriptorSetCache::acquire(
+            const DescriptorSetLayout &setLayout, std::vector<VkWriteDescriptorSet> &writes, VkDescriptorSet &set) {
+        // non dispatchable handles are pointers on 64 bit platforms
+        auto handle = [](const auto *object) { return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(object)); };
+        key.clear();
+        key.push_back(handle(setLayout.getDescriptorSetLayout()));
+        for (const auto &write: writes) {
+            key.push_back(uint64_t{write.dstBinding} << 32 | static_cast<uint32_t>(write.descriptorType));
+            if (write.pBufferInfo != nullptr) {
+                key.push_back(handle(write.pBufferInfo->buffer));
+                key.push_back(write.pBufferInfo->offset);
+                key.push_back(write.pBufferInfo->range);
+            }
+            if (write.pImageInfo != nullptr) {
+                key.push_back(handle(write.pImageInfo->sampler));
+                key.push_back(handle(write.pImageInfo->imageView));
+                key.push_back(static_cast<uint64_t>(write.pImageInfo->imageLayout));
+            }
+        }
+
+        auto it = sets.find(key);
+        if (it != sets.end()) {
+            it->second.lastUsedFrame = frameNumber;
+            set = it->second.set;
+            return true;
+        }
+
+        if (!pool->allocateDescriptor(setLayout.getDescriptorSetLayout(), set)) {
+            throw std::runtime_error("descriptor set cache pool is full");
+        }
+        for (auto &write: writes) {
+            write.dstSet = set;
+        }
+        vkUpdateDescriptorSets(device.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        writeCount += static_cast<uint32_t>(writes.size());
+        sets.emplace(key, CachedSet{set, frameNumber});
+        return true;
+    }
+
 }  // namespace Ocean
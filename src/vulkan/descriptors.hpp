@@ -21,15 +21,21 @@ namespace Ocean {
                     VkShaderStageFlags stageFlags,
                     uint32_t count = 1);
 
+            // e.g. partially bound or update after bind, the binding has to be added first
+            Builder &setBindingFlags(uint32_t binding, VkDescriptorBindingFlags flags);
+
             [[nodiscard]] std::unique_ptr<DescriptorSetLayout> build() const;
 
         private:
             Device &device;
             std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+            std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags{};
         };
 
         DescriptorSetLayout(
-                Device &device, const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings);
+                Device &device,
+                const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings,
+                const std::unordered_map<uint32_t, VkDescriptorBindingFlags> &bindingFlags = {});
 
         ~DescriptorSetLayout();
 
@@ -94,10 +100,73 @@ namespace Ocean {
         friend class DescriptorWriter;
     };
 
+    class DescriptorWriter;
+
+    // Keeps descriptor sets across frames, keyed by their layout and every resource written to
+    // them. Requesting a set that already exists returns it without allocating or writing, so a
+    // scene whose buffers and textures don't change stops touching descriptors altogether.
+    // Sets that go unrequested for framesInFlight frames are freed. A resource retired through
+    // Device::deferDestruction outlives its sets that long, so a recycled handle never finds a set
+    // pointing at the old resource. Resources destroyed while the device is idle, like the swap
+    // chain attachments, skip that wait, so every set is dropped after
+    // Device::releaseAllRetiredResources runs.
+    class DescriptorSetCache {
+    public:
+        DescriptorSetCache(Device &device, uint32_t framesInFlight, std::unique_ptr<DescriptorPool> pool);
+
+        ~DescriptorSetCache();
+
+        DescriptorSetCache(const DescriptorSetCache &) = delete;
+
+        DescriptorSetCache &operator=(const DescriptorSetCache &) = delete;
+
+        // frees stale sets and resets the write count, call once the frame's fence has been waited on
+        void beginFrame();
+
+        // frees every set, only call while none of them is in use by the GPU
+        void clear();
+
+        // descriptors written since beginFrame, zero once every set of a frame comes from the cache
+        [[nodiscard]] uint32_t getWriteCount() const { return writeCount; }
+
+        [[nodiscard]] size_t size() const { return sets.size(); }
+
+    private:
+        struct KeyHash {
+            size_t operator()(const std::vector<uint64_t> &key) const;
+        };
+
+        struct CachedSet {
+            VkDescriptorSet set;
+            uint64_t lastUsedFrame;
+        };
+
+        // returns the set matching layout and writes, allocating and writing it on a miss
+        bool acquire(const DescriptorSetLayout &setLayout, std::vector<VkWriteDescriptorSet> &writes, VkDescriptorSet &set);
+
+        Device &device;
+        uint32_t framesInFlight;
+        std::unique_ptr<DescriptorPool> pool;
+        std::unordered_map<std::vector<uint64_t>, CachedSet, KeyHash> sets;
+        std::vector<uint64_t> key;  // scratch, kept to reuse its capacity
+        std::vector<VkWriteDescriptorSet> writeScratch;  // of the writer being built, kept like key
+        std::vector<VkDescriptorSet> staleSets;
+        uint64_t frameNumber = 0;
+        uint32_t writeCount = 0;
+        uint64_t idleReleaseCount;  // of the device when the sets were last cleared
+
+        friend class DescriptorWriter;
+    };
+
     class DescriptorWriter {
     public:
         DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorPool &pool);
 
+        // build looks the set up in cache and only allocates and writes it if it is missing. The
+        // writes are gathered in the cache's scratch storage so building a cached set doesn't
+        // allocate, only one such writer per cache can be in use at a time
+        DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorSetCache &cache);
+
         DescriptorWriter &writeBuffer(uint32_t binding, VkDescriptorBufferInfo *bufferInfo);
 
         DescriptorWriter &writeImage(uint32_t binding, VkDescriptorImageInfo *imageInfo);
@@ -109,7 +178,9 @@ namespace Ocean {
     private:
         DescriptorSetLayout &setLayout;
         DescriptorPool &pool;
-        std::vector<VkWriteDescriptorSet> writes;
+        DescriptorSetCache *cache = nullptr;
+        std::vector<VkWriteDescriptorSet> ownWrites;
+        std::vector<VkWriteDescriptorSet> &writes;  // ownWrites, or the cache's scratch storage
     };
 
 }  // namespace Ocean
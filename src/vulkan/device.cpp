@@ -57,6 +57,9 @@ namespace Ocean {
     }
 
     Device::~Device() {
+        vkDeviceWaitIdle(device_);
+        releaseAllRetiredResources();
+
         vkDestroyCommandPool(device_, commandPool, nullptr);
         vkDestroyDevice(device_, nullptr);
 
@@ -132,6 +135,12 @@ namespace Ocean {
 
         vkGetPhysicalDeviceProperties(physicalDevice, &properties);
         std::cout << "physical device: " << properties.deviceName << std::endl;
+
+        descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &descriptorIndexingProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
     }
 
     void Device::createLogicalDevice() {
@@ -150,18 +159,41 @@ namespace Ocean {
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
         VkPhysicalDeviceFeatures deviceFeatures = {};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
+        // indirect draws with several commands or a non zero firstInstance
+        deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+        deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+        enabledFeatures = deviceFeatures;
+
+        // bindless texture table, checked by isDeviceSuitable
+        VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures{};
+        descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+        descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+        descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+
+        // descriptor indexing is core in 1.2, older devices need the extension
+        std::vector<const char *> enabledExtensions = deviceExtensions;
+        if (properties.apiVersion < VK_API_VERSION_1_2) {
+            enabledExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+            enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+        }
 
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = &descriptorIndexingFeatures;
 
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
         createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
         // might not really be necessary anymore because device specific validation layers
         // have been deprecated
@@ -211,7 +243,36 @@ namespace Ocean {
         vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
         return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-               supportedFeatures.samplerAnisotropy;
+               supportedFeatures.samplerAnisotropy && checkDescriptorIndexingSupport(device);
+    }
+
+    bool Device::checkDescriptorIndexingSupport(VkPhysicalDevice device) {
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(device, &deviceProperties);
+        if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+            uint32_t extensionCount;
+            vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+            std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+            vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+            bool hasExtension = false;
+            for (const auto &extension: availableExtensions) {
+                if (std::string{extension.extensionName} == VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) {
+                    hasExtension = true;
+                }
+            }
+            if (!hasExtension) return false;
+        }
+
+        VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &indexingFeatures;
+        vkGetPhysicalDeviceFeatures2(device, &features2);
+        return indexingFeatures.shaderSampledImageArrayNonUniformIndexing &&
+               indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+               indexingFeatures.descriptorBindingPartiallyBound &&
+               indexingFeatures.runtimeDescriptorArray;
     }
 
     void Device::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo) {
@@ -330,7 +391,9 @@ namespace Ocean {
 
         int i = 0;
         for (const auto &queueFamily: queueFamilies) {
-            if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            // culling runs as compute work on the graphics queue
+            const VkQueueFlags graphicsFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+            if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & graphicsFlags) == graphicsFlags) {
                 indices.graphicsFamily = i;
                 indices.graphicsFamilyHasValue = true;
             }
@@ -468,12 +531,13 @@ namespace Ocean {
         vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
     }
 
-    void Device::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+    void Device::copyBuffer(
+            VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset) {
         VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
         VkBufferCopy copyRegion{};
-        copyRegion.srcOffset = 0;  // Optional
-        copyRegion.dstOffset = 0;  // Optional
+        copyRegion.srcOffset = srcOffset;
+        copyRegion.dstOffset = dstOffset;
         copyRegion.size = size;
         vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
@@ -619,4 +683,22 @@ namespace Ocean {
         endSingleTimeCommands(commandBuffer);
     }
 
+    void Device::deferDestruction(std::function<void()> destroyFn) {
+        deletionQueue.push(currentFrameNumber, std::move(destroyFn));
+    }
+
+    void Device::releaseRetiredResources(uint64_t frameNumber, uint32_t framesInFlight) {
+        // the caller has waited on the fence of frameNumber's slot, so every frame at least
+        // framesInFlight frames older than it has completed on the GPU
+        currentFrameNumber = frameNumber;
+        if (frameNumber >= framesInFlight) {
+            deletionQueue.flush(frameNumber - framesInFlight);
+        }
+    }
+
+    void Device::releaseAllRetiredResources() {
+        deletionQueue.flushAll();
+        idleReleaseCount++;
+    }
+
 }  // namespace lve
\ No newline at end of file
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "window.hpp"
+#include "deletion_queue.hpp"
 
 // std lib headers
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -75,7 +77,12 @@ namespace Ocean {
 
         void endSingleTimeCommands(VkCommandBuffer commandBuffer);
 
-        void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+        void copyBuffer(
+                VkBuffer srcBuffer,
+                VkBuffer dstBuffer,
+                VkDeviceSize size,
+                VkDeviceSize srcOffset = 0,
+                VkDeviceSize dstOffset = 0);
 
         void copyBufferToImage(
                 VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
@@ -94,7 +101,26 @@ namespace Ocean {
                 uint32_t mipLevels = 1,
                 uint32_t layerCount = 1);
 
+        // Deferred destruction
+        // Objects retired here may still be used by frames in flight, they are destroyed once
+        // every frame recorded up to the point of retirement has finished executing
+        void deferDestruction(std::function<void()> destroyFn);
+
+        void releaseRetiredResources(uint64_t frameNumber, uint32_t framesInFlight);
+
+        // only call once the device is idle (swap chain recreation, shutdown). The handles freed
+        // here can be reused at once, so this also bumps the idle release count
+        void releaseAllRetiredResources();
+
+        // times releaseAllRetiredResources ran, caches keyed by handle values drop their entries
+        // when it changes
+        [[nodiscard]] uint64_t getIdleReleaseCount() const { return idleReleaseCount; }
+
         VkPhysicalDeviceProperties properties{};
+        // optional features are only set if the device supports them
+        VkPhysicalDeviceFeatures enabledFeatures{};
+        // limits of update after bind descriptors, which hold the bindless texture table
+        VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties{};
 
     private:
         void createInstance();
@@ -112,6 +138,9 @@ namespace Ocean {
         // helper functions
         bool isDeviceSuitable(VkPhysicalDevice device);
 
+        // runtime sized, partially bound, update after bind arrays of sampled images
+        static bool checkDescriptorIndexingSupport(VkPhysicalDevice device);
+
         std::vector<const char *> getRequiredExtensions() const;
 
         bool checkValidationLayerSupport();
@@ -137,6 +166,10 @@ namespace Ocean {
         VkQueue graphicsQueue_{};
         VkQueue presentQueue_{};
 
+        DeletionQueue deletionQueue;
+        uint64_t idleReleaseCount = 0;
+        uint64_t currentFrameNumber = 0;
+
         const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
         const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME,
                                                             "VK_KHR_portability_subset"};
@@ -59,10 +59,13 @@ namespace Ocean {
                 "Cannot create graphics pipeline: no renderPass provided in configInfo");
 
         auto vertCode = readFile(vertFilepath);
-        auto fragCode = readFile(fragFilepath);
-
         createShaderModule(vertCode, &vertShaderModule);
-        createShaderModule(fragCode, &fragShaderModule);
+
+        const bool hasFragmentStage = !fragFilepath.empty();
+        if (hasFragmentStage) {
+            auto fragCode = readFile(fragFilepath);
+            createShaderModule(fragCode, &fragShaderModule);
+        }
 
         VkPipelineShaderStageCreateInfo shaderStages[2];
         shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -92,7 +95,7 @@ namespace Ocean {
 
         VkGraphicsPipelineCreateInfo pipelineInfo{};
         pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.stageCount = 2;
+        pipelineInfo.stageCount = hasFragmentStage ? 2 : 1;
         pipelineInfo.pStages = shaderStages;
         pipelineInfo.pVertexInputState = &vertexInputInfo;
         pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
@@ -223,4 +226,44 @@ namespace Ocean {
         configInfo.colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
     }
 
+    ComputePipeline::ComputePipeline(
+            Device &device, const std::string &compFilepath, VkPipelineLayout pipelineLayout)
+            : device{device} {
+        assert(
+                pipelineLayout != VK_NULL_HANDLE &&
+                "Cannot create compute pipeline: no pipelineLayout provided");
+
+        auto compCode = Pipeline::readFile(compFilepath);
+
+        VkShaderModuleCreateInfo moduleInfo{};
+        moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        moduleInfo.codeSize = compCode.size();
+        moduleInfo.pCode = reinterpret_cast<const uint32_t *>(compCode.data());
+        if (vkCreateShaderModule(device.device(), &moduleInfo, nullptr, &compShaderModule) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shader module");
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = compShaderModule;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = pipelineLayout;
+
+        if (vkCreateComputePipelines(device.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &computePipeline) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to create compute pipeline");
+        }
+    }
+
+    ComputePipeline::~ComputePipeline() {
+        vkDestroyShaderModule(device.device(), compShaderModule, nullptr);
+        vkDestroyPipeline(device.device(), computePipeline, nullptr);
+    }
+
+    void ComputePipeline::bind(VkCommandBuffer commandBuffer) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+    }
+
 }  // namespace Ocean
@@ -33,6 +33,8 @@ namespace Ocean {
 
     class Pipeline {
     public:
+        // an empty fragFilepath creates a pipeline without fragment stage, e.g. for depth only
+        // passes, its config should mask out color writes
         Pipeline(Device &device,
                  const std::string &vertFilepath,
                  const std::string &fragFilepath,
@@ -50,9 +52,10 @@ namespace Ocean {
 
         static void enableAlphaBlending(PipelineConfigInfo &configInfo);
 
-    private:
         static std::vector<char> readFile(const std::string &filepath);
 
+    private:
+
         void createGraphicsPipeline(
                 const std::string &vertFilepath,
                 const std::string &fragFilepath,
@@ -65,4 +68,22 @@ namespace Ocean {
         VkShaderModule vertShaderModule{};
         VkShaderModule fragShaderModule{};
     };
+
+    class ComputePipeline {
+    public:
+        ComputePipeline(Device &device, const std::string &compFilepath, VkPipelineLayout pipelineLayout);
+
+        ~ComputePipeline();
+
+        ComputePipeline(const ComputePipeline &) = delete;
+
+        ComputePipeline &operator=(const ComputePipeline &) = delete;
+
+        void bind(VkCommandBuffer commandBuffer);
+
+    private:
+        Device &device;
+        VkPipeline computePipeline{};
+        VkShaderModule compShaderModule{};
+    };
 }  // namespace Ocean
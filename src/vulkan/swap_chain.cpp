@@ -11,6 +11,19 @@
 
 namespace Ocean {
 
+    namespace {
+
+        constexpr VkFormat ALBEDO_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+        constexpr VkFormat NORMAL_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+        // attachment indices of the deferred framebuffer, color and depth match the forward one
+        constexpr uint32_t COLOR_ATTACHMENT = 0;
+        constexpr uint32_t DEPTH_ATTACHMENT = 1;
+        constexpr uint32_t ALBEDO_ATTACHMENT = 2;
+        constexpr uint32_t NORMAL_ATTACHMENT = 3;
+
+    }  // namespace
+
     SwapChain::SwapChain(Device &deviceRef, VkExtent2D extent)
             : device{deviceRef}, windowExtent{extent} {
         init();
@@ -26,8 +39,9 @@ namespace Ocean {
     void SwapChain::init() {
         createSwapChain();
         createImageViews();
-        createRenderPass();
+        createRenderPasses();
         createDepthResources();
+        createGBufferResources();
         createFramebuffers();
         createSyncObjects();
     }
@@ -43,17 +57,23 @@ namespace Ocean {
             swapChain = nullptr;
         }
 
-        for (int i = 0; i < depthImages.size(); i++) {
-            vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
-            vkDestroyImage(device.device(), depthImages[i], nullptr);
-            vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+        for (auto *attachments: {&depthAttachments, &albedoAttachments, &normalAttachments}) {
+            for (auto &attachment: *attachments) {
+                destroyAttachment(attachment);
+            }
         }
 
         for (auto framebuffer: swapChainFramebuffers) {
             vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
         }
+        for (auto framebuffer: deferredFramebuffers) {
+            vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+        }
 
-        vkDestroyRenderPass(device.device(), renderPass, nullptr);
+        for (auto renderPass: renderPasses) {
+            vkDestroyRenderPass(device.device(), renderPass, nullptr);
+        }
+        vkDestroyRenderPass(device.device(), deferredRenderPass, nullptr);
 
         // cleanup synchronization objects
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
@@ -211,16 +231,28 @@ namespace Ocean {
         }
     }
 
-    void SwapChain::createRenderPass() {
+    void SwapChain::createRenderPasses() {
+        for (auto phase: {RenderPassPhase::Whole, RenderPassPhase::First, RenderPassPhase::Second}) {
+            renderPasses[static_cast<size_t>(phase)] = createRenderPass(phase);
+        }
+        createDeferredRenderPass();
+    }
+
+    VkRenderPass SwapChain::createRenderPass(RenderPassPhase phase) {
+        const bool continues = phase == RenderPassPhase::Second;
+        const bool continued = phase == RenderPassPhase::First;
+
         VkAttachmentDescription depthAttachment{};
         depthAttachment.format = findDepthFormat();
         depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.loadOp = continues ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = continued ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
         depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depthAttachment.initialLayout =
+                continues ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.finalLayout = continued ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+                                                : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
         VkAttachmentReference depthAttachmentRef{};
         depthAttachmentRef.attachment = 1;
@@ -229,12 +261,14 @@ namespace Ocean {
         VkAttachmentDescription colorAttachment = {};
         colorAttachment.format = getSwapChainImageFormat();
         colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.loadOp = continues ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
         colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        colorAttachment.initialLayout =
+                continues ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.finalLayout =
+                continued ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
         VkAttachmentReference colorAttachmentRef = {};
         colorAttachmentRef.attachment = 0;
@@ -246,7 +280,8 @@ namespace Ocean {
         subpass.pColorAttachments = &colorAttachmentRef;
         subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
-        VkSubpassDependency dependency = {};
+        std::vector<VkSubpassDependency> dependencies(1);
+        VkSubpassDependency &dependency = dependencies[0];
         dependency.dstSubpass = 0;
         dependency.dstAccessMask =
                 VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
@@ -256,6 +291,26 @@ namespace Ocean {
         dependency.srcAccessMask = 0;
         dependency.srcStageMask =
                 VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        if (continues) {
+            // attachments written by the first pass, depth also read by compute in between
+            dependency.srcStageMask |=
+                    VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            dependency.srcAccessMask =
+                    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            dependency.dstAccessMask |=
+                    VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        }
+        if (continued) {
+            // compute shaders sample the stored depth before the second pass
+            VkSubpassDependency outgoing = {};
+            outgoing.srcSubpass = 0;
+            outgoing.dstSubpass = VK_SUBPASS_EXTERNAL;
+            outgoing.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            outgoing.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            outgoing.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            outgoing.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            dependencies.push_back(outgoing);
+        }
 
         std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
         VkRenderPassCreateInfo renderPassInfo = {};
@@ -264,29 +319,144 @@ namespace Ocean {
         renderPassInfo.pAttachments = attachments.data();
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpass;
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &dependency;
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
 
+        VkRenderPass renderPass;
         if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
             throw std::runtime_error("failed to create render pass!");
         }
+        return renderPass;
+    }
+
+    void SwapChain::createDeferredRenderPass() {
+        VkAttachmentDescription colorAttachment = {};
+        colorAttachment.format = getSwapChainImageFormat();
+        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+        // the G-buffer and depth are produced and consumed inside the pass, nothing is stored
+        VkAttachmentDescription depthAttachment = colorAttachment;
+        depthAttachment.format = findDepthFormat();
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+        VkAttachmentDescription albedoAttachment = depthAttachment;
+        albedoAttachment.format = ALBEDO_FORMAT;
+        albedoAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        VkAttachmentDescription normalAttachment = albedoAttachment;
+        normalAttachment.format = NORMAL_FORMAT;
+
+        std::array<VkAttachmentReference, 2> gBufferRefs{{
+                {ALBEDO_ATTACHMENT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
+                {NORMAL_ATTACHMENT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL}}};
+        VkAttachmentReference depthRef{DEPTH_ATTACHMENT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+        // input_attachment_index 0, 1 and 2 in deferred_lighting.frag
+        std::array<VkAttachmentReference, 3> inputRefs{{
+                {ALBEDO_ATTACHMENT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+                {NORMAL_ATTACHMENT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+                {DEPTH_ATTACHMENT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL}}};
+        VkAttachmentReference colorRef{COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+        VkAttachmentReference readOnlyDepthRef{DEPTH_ATTACHMENT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+
+        std::array<VkSubpassDescription, 3> subpasses{};
+        VkSubpassDescription &gBufferSubpass = subpasses[GBUFFER_SUBPASS];
+        gBufferSubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        gBufferSubpass.colorAttachmentCount = static_cast<uint32_t>(gBufferRefs.size());
+        gBufferSubpass.pColorAttachments = gBufferRefs.data();
+        gBufferSubpass.pDepthStencilAttachment = &depthRef;
+
+        // the color attachment is written once per covered pixel, without depth testing
+        VkSubpassDescription &lightingSubpass = subpasses[LIGHTING_SUBPASS];
+        lightingSubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        lightingSubpass.inputAttachmentCount = static_cast<uint32_t>(inputRefs.size());
+        lightingSubpass.pInputAttachments = inputRefs.data();
+        lightingSubpass.colorAttachmentCount = 1;
+        lightingSubpass.pColorAttachments = &colorRef;
+
+        VkSubpassDescription &forwardSubpass = subpasses[FORWARD_SUBPASS];
+        forwardSubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        forwardSubpass.colorAttachmentCount = 1;
+        forwardSubpass.pColorAttachments = &colorRef;
+        forwardSubpass.pDepthStencilAttachment = &readOnlyDepthRef;
+
+        std::array<VkSubpassDependency, 3> dependencies{};
+        VkSubpassDependency &incoming = dependencies[0];
+        incoming.srcSubpass = VK_SUBPASS_EXTERNAL;
+        incoming.dstSubpass = GBUFFER_SUBPASS;
+        incoming.srcStageMask =
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        incoming.srcAccessMask = 0;
+        incoming.dstStageMask =
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        incoming.dstAccessMask =
+                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        // by region, each pixel only reads what was written at its own position, which lets tile
+        // based GPUs keep the G-buffer in tile memory
+        VkSubpassDependency &gBufferToLighting = dependencies[1];
+        gBufferToLighting.srcSubpass = GBUFFER_SUBPASS;
+        gBufferToLighting.dstSubpass = LIGHTING_SUBPASS;
+        gBufferToLighting.srcStageMask =
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        gBufferToLighting.srcAccessMask =
+                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        gBufferToLighting.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        gBufferToLighting.dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+        gBufferToLighting.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+        VkSubpassDependency &lightingToForward = dependencies[2];
+        lightingToForward.srcSubpass = LIGHTING_SUBPASS;
+        lightingToForward.dstSubpass = FORWARD_SUBPASS;
+        lightingToForward.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        lightingToForward.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        lightingToForward.dstStageMask =
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        lightingToForward.dstAccessMask =
+                VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        lightingToForward.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+        std::array<VkAttachmentDescription, 4> attachments{};
+        attachments[COLOR_ATTACHMENT] = colorAttachment;
+        attachments[DEPTH_ATTACHMENT] = depthAttachment;
+        attachments[ALBEDO_ATTACHMENT] = albedoAttachment;
+        attachments[NORMAL_ATTACHMENT] = normalAttachment;
+        VkRenderPassCreateInfo renderPassInfo = {};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+        renderPassInfo.pSubpasses = subpasses.data();
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
+
+        if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &deferredRenderPass) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create deferred render pass!");
+        }
     }
 
     void SwapChain::createFramebuffers() {
+        VkExtent2D swapChainExtent = getSwapChainExtent();
+        VkFramebufferCreateInfo framebufferInfo = {};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.width = swapChainExtent.width;
+        framebufferInfo.height = swapChainExtent.height;
+        framebufferInfo.layers = 1;
+
         swapChainFramebuffers.resize(imageCount());
+        deferredFramebuffers.resize(imageCount());
         for (size_t i = 0; i < imageCount(); i++) {
-            std::array<VkImageView, 2> attachments = {swapChainImageViews[i], depthImageViews[i]};
-
-            VkExtent2D swapChainExtent = getSwapChainExtent();
-            VkFramebufferCreateInfo framebufferInfo = {};
-            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-            framebufferInfo.renderPass = renderPass;
+            std::array<VkImageView, 2> attachments = {swapChainImageViews[i], depthAttachments[i].view};
+            framebufferInfo.renderPass = getRenderPass();
             framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
             framebufferInfo.pAttachments = attachments.data();
-            framebufferInfo.width = swapChainExtent.width;
-            framebufferInfo.height = swapChainExtent.height;
-            framebufferInfo.layers = 1;
-
             if (vkCreateFramebuffer(
                     device.device(),
                     &framebufferInfo,
@@ -294,56 +464,102 @@ namespace Ocean {
                     &swapChainFramebuffers[i]) != VK_SUCCESS) {
                 throw std::runtime_error("failed to create framebuffer!");
             }
+
+            std::array<VkImageView, 4> deferredAttachments{};
+            deferredAttachments[COLOR_ATTACHMENT] = swapChainImageViews[i];
+            deferredAttachments[DEPTH_ATTACHMENT] = depthAttachments[i].view;
+            deferredAttachments[ALBEDO_ATTACHMENT] = albedoAttachments[i].view;
+            deferredAttachments[NORMAL_ATTACHMENT] = normalAttachments[i].view;
+            framebufferInfo.renderPass = deferredRenderPass;
+            framebufferInfo.attachmentCount = static_cast<uint32_t>(deferredAttachments.size());
+            framebufferInfo.pAttachments = deferredAttachments.data();
+            if (vkCreateFramebuffer(
+                    device.device(),
+                    &framebufferInfo,
+                    nullptr,
+                    &deferredFramebuffers[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create framebuffer!");
+            }
         }
     }
 
     void SwapChain::createDepthResources() {
         VkFormat depthFormat = findDepthFormat();
         swapChainDepthFormat = depthFormat;
-        VkExtent2D swapChainExtent = getSwapChainExtent();
 
-        depthImages.resize(imageCount());
-        depthImageMemorys.resize(imageCount());
-        depthImageViews.resize(imageCount());
-
-        for (int i = 0; i < depthImages.size(); i++) {
-            VkImageCreateInfo imageInfo{};
-            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-            imageInfo.imageType = VK_IMAGE_TYPE_2D;
-            imageInfo.extent.width = swapChainExtent.width;
-            imageInfo.extent.height = swapChainExtent.height;
-            imageInfo.extent.depth = 1;
-            imageInfo.mipLevels = 1;
-            imageInfo.arrayLayers = 1;
-            imageInfo.format = depthFormat;
-            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-            imageInfo.flags = 0;
-
-            device.createImageWithInfo(
-                    imageInfo,
-                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                    depthImages[i],
-                    depthImageMemorys[i]);
+        // sampled when building the depth pyramid for occlusion culling, read as an input
+        // attachment by deferred lighting
+        depthAttachments.resize(imageCount());
+        for (auto &attachment: depthAttachments) {
+            attachment = createAttachment(
+                    depthFormat,
+                    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                    VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
+                    VK_IMAGE_ASPECT_DEPTH_BIT);
+        }
+    }
 
-            VkImageViewCreateInfo viewInfo{};
-            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-            viewInfo.image = depthImages[i];
-            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-            viewInfo.format = depthFormat;
-            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-            viewInfo.subresourceRange.baseMipLevel = 0;
-            viewInfo.subresourceRange.levelCount = 1;
-            viewInfo.subresourceRange.baseArrayLayer = 0;
-            viewInfo.subresourceRange.layerCount = 1;
+    void SwapChain::createGBufferResources() {
+        // transient, the contents never leave the deferred render pass
+        const VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT |
+                                        VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        albedoAttachments.resize(imageCount());
+        normalAttachments.resize(imageCount());
+        for (size_t i = 0; i < imageCount(); i++) {
+            albedoAttachments[i] = createAttachment(ALBEDO_FORMAT, usage, VK_IMAGE_ASPECT_COLOR_BIT);
+            normalAttachments[i] = createAttachment(NORMAL_FORMAT, usage, VK_IMAGE_ASPECT_COLOR_BIT);
+        }
+    }
 
-            if (vkCreateImageView(device.device(), &viewInfo, nullptr, &depthImageViews[i]) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create texture image view!");
-            }
+    SwapChain::Attachment SwapChain::createAttachment(
+            VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspectMask) {
+        VkExtent2D swapChainExtent = getSwapChainExtent();
+        Attachment attachment{};
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = swapChainExtent.width;
+        imageInfo.extent.height = swapChainExtent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = usage;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.flags = 0;
+
+        device.createImageWithInfo(
+                imageInfo,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                attachment.image,
+                attachment.memory);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = attachment.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange.aspectMask = aspectMask;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device.device(), &viewInfo, nullptr, &attachment.view) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture image view!");
         }
+        return attachment;
+    }
+
+    void SwapChain::destroyAttachment(Attachment &attachment) {
+        vkDestroyImageView(device.device(), attachment.view, nullptr);
+        vkDestroyImage(device.device(), attachment.image, nullptr);
+        vkFreeMemory(device.device(), attachment.memory, nullptr);
+        attachment = Attachment{};
     }
 
     void SwapChain::createSyncObjects() {
@@ -422,7 +638,7 @@ namespace Ocean {
         return device.findSupportedFormat(
                 {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
                 VK_IMAGE_TILING_OPTIMAL,
-                VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+                VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
     }
 
 }  // namespace Ocean
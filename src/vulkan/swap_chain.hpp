@@ -6,6 +6,7 @@
 #include <vulkan/vulkan.h>
 
 // std lib headers
+#include <array>
 #include <memory>
 #include <string>
 #include <vector>
@@ -16,6 +17,23 @@ namespace Ocean {
     public:
         static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
+        // The frame can be rendered in one pass or split in two around compute work reading the
+        // depth attachment. First stores depth and leaves it sampleable, Second loads both
+        // attachments and presents. All three are compatible, so framebuffers, pipelines and
+        // secondary command buffers work with any of them
+        enum class RenderPassPhase {
+            Whole,
+            First,
+            Second
+        };
+
+        // Subpasses of the deferred render pass: the G-buffer is filled, then every pixel is lit
+        // from it through input attachments, then forward geometry like light billboards is drawn
+        // on top, testing against the G-buffer depth. The G-buffer never leaves the render pass
+        static constexpr uint32_t GBUFFER_SUBPASS = 0;
+        static constexpr uint32_t LIGHTING_SUBPASS = 1;
+        static constexpr uint32_t FORWARD_SUBPASS = 2;
+
         SwapChain(Device &deviceRef, VkExtent2D windowExtent);
 
         SwapChain(
@@ -29,10 +47,25 @@ namespace Ocean {
 
         VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
 
-        VkRenderPass getRenderPass() { return renderPass; }
+        VkRenderPass getRenderPass(RenderPassPhase phase = RenderPassPhase::Whole) {
+            return renderPasses[static_cast<size_t>(phase)];
+        }
+
+        VkFramebuffer getDeferredFrameBuffer(int index) { return deferredFramebuffers[index]; }
+
+        VkRenderPass getDeferredRenderPass() { return deferredRenderPass; }
 
         VkImageView getImageView(int index) { return swapChainImageViews[index]; }
 
+        // depth only view, in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL between the First and
+        // Second render pass
+        VkImageView getDepthImageView(int index) { return depthAttachments[index].view; }
+
+        // G-buffer attachments, only valid as input attachments in LIGHTING_SUBPASS
+        VkImageView getAlbedoImageView(int index) { return albedoAttachments[index].view; }
+
+        VkImageView getNormalImageView(int index) { return normalAttachments[index].view; }
+
         size_t imageCount() { return swapChainImages.size(); }
 
         VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
@@ -59,6 +92,13 @@ namespace Ocean {
         }
 
     private:
+        // image, memory and view of a render target owned by the swap chain
+        struct Attachment {
+            VkImage image = VK_NULL_HANDLE;
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkImageView view = VK_NULL_HANDLE;
+        };
+
         void init();
 
         void createSwapChain();
@@ -67,7 +107,17 @@ namespace Ocean {
 
         void createDepthResources();
 
-        void createRenderPass();
+        void createGBufferResources();
+
+        Attachment createAttachment(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspectMask);
+
+        void destroyAttachment(Attachment &attachment);
+
+        void createRenderPasses();
+
+        VkRenderPass createRenderPass(RenderPassPhase phase);
+
+        void createDeferredRenderPass();
 
         void createFramebuffers();
 
@@ -87,11 +137,13 @@ namespace Ocean {
         VkExtent2D swapChainExtent{};
 
         std::vector<VkFramebuffer> swapChainFramebuffers;
-        VkRenderPass renderPass{};
+        std::array<VkRenderPass, 3> renderPasses{};  // indexed by RenderPassPhase
+        std::vector<VkFramebuffer> deferredFramebuffers;
+        VkRenderPass deferredRenderPass = VK_NULL_HANDLE;
 
-        std::vector<VkImage> depthImages;
-        std::vector<VkDeviceMemory> depthImageMemorys;
-        std::vector<VkImageView> depthImageViews;
+        std::vector<Attachment> depthAttachments;
+        std::vector<Attachment> albedoAttachments;
+        std::vector<Attachment> normalAttachments;
         std::vector<VkImage> swapChainImages;
         std::vector<VkImageView> swapChainImageViews;
 
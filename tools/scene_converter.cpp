@@ -0,0 +1,226 @@
+// Converts text scenes (.scene) to the binary format loaded by the engine (.oscene).
+//
+//   scene_converter <input.scene> <output.oscene>
+//   scene_converter --generate <objectCount> <model path> <output.oscene>
+//
+// Text scenes hold one statement per line, '#' starts a comment:
+//
+//   model <name> <path>
+//   texture <name> <path>
+//   object <name> [model=<name>] [texture=<name>] [parent=<name>] [translation=x,y,z]
+//                 [rotation=x,y,z] [scale=x,y,z] [color=r,g,b]
+//   light <name> [intensity=f] [radius=f] [parent=<name>] [translation=x,y,z] [color=r,g,b]
+//
+// Names must be declared before they are referenced.
+
+#include "scene_file.hpp"
+
+// std
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+    using Ocean::SceneData;
+
+    class TextSceneParser {
+    public:
+        SceneData parse(const std::string &filepath) {
+            std::ifstream file{filepath};
+            if (!file) {
+                throw std::runtime_error("failed to open file: " + filepath);
+            }
+            std::string line;
+            while (std::getline(file, line)) {
+                lineNumber++;
+                line = line.substr(0, line.find('#'));
+                std::istringstream tokens{line};
+                std::string statement;
+                if (!(tokens >> statement)) continue;
+
+                if (statement == "model") {
+                    declareAsset(tokens, modelNames, scene.modelPaths);
+                } else if (statement == "texture") {
+                    declareAsset(tokens, textureNames, scene.texturePaths);
+                } else if (statement == "object") {
+                    parseObject(tokens, false);
+                } else if (statement == "light") {
+                    parseObject(tokens, true);
+                } else {
+                    fail("unknown statement '" + statement + "'");
+                }
+            }
+            scene.validate();
+            return std::move(scene);
+        }
+
+    private:
+        [[noreturn]] void fail(const std::string &message) const {
+            throw std::runtime_error("line " + std::to_string(lineNumber) + ": " + message);
+        }
+
+        std::string nextToken(std::istringstream &tokens, const char *what) const {
+            std::string token;
+            if (!(tokens >> token)) fail(std::string{"expected "} + what);
+            return token;
+        }
+
+        void declareAsset(
+                std::istringstream &tokens,
+                std::unordered_map<std::string, uint32_t> &names,
+                std::vector<std::string> &paths) {
+            std::string name = nextToken(tokens, "a name");
+            std::string path = nextToken(tokens, "a path");
+            if (!names.emplace(name, static_cast<uint32_t>(paths.size())).second) {
+                fail("'" + name + "' is declared twice");
+            }
+            paths.push_back(path);
+        }
+
+        uint32_t lookup(const std::unordered_map<std::string, uint32_t> &names, const std::string &name) const {
+            auto it = names.find(name);
+            if (it == names.end()) fail("'" + name + "' is not declared");
+            return it->second;
+        }
+
+        float parseFloat(const std::string &value) const {
+            char *end = nullptr;
+            float result = std::strtof(value.c_str(), &end);
+            if (end == value.c_str() || *end != '\0' || !std::isfinite(result)) {
+                fail("'" + value + "' is not a number");
+            }
+            return result;
+        }
+
+        glm::vec3 parseVec3(const std::string &value) const {
+            glm::vec3 result{};
+            size_t start = 0;
+            for (int i = 0; i < 3; i++) {
+                size_t end = value.find(',', start);
+                if ((i < 2) == (end == std::string::npos)) {
+                    fail("'" + value + "' is not a vector of 3 numbers");
+                }
+                result[i] = parseFloat(value.substr(start, end - start));
+                start = end + 1;
+            }
+            return result;
+        }
+
+        void parseObject(std::istringstream &tokens, bool isLight) {
+            std::string name = nextToken(tokens, "a name");
+            uint32_t index = scene.objectCount();
+            if (!objectNames.emplace(name, index).second) {
+                fail("'" + name + "' is declared twice");
+            }
+
+            glm::vec3 translation{0.f};
+            glm::vec3 rotation{0.f};
+            glm::vec3 scale{1.f};
+            glm::vec3 color{isLight ? 1.f : 0.f};
+            uint32_t model = SceneData::NO_REFERENCE;
+            uint32_t texture = SceneData::NO_REFERENCE;
+            uint32_t parent = SceneData::NO_REFERENCE;
+            // same defaults as GameObjectManager::makePointLight
+            float intensity = 10.f;
+            float radius = 0.1f;
+
+            std::string property;
+            while (tokens >> property) {
+                size_t separator = property.find('=');
+                if (separator == std::string::npos) fail("expected key=value, got '" + property + "'");
+                std::string key = property.substr(0, separator);
+                std::string value = property.substr(separator + 1);
+
+                if (key == "translation") {
+                    translation = parseVec3(value);
+                } else if (key == "color") {
+                    color = parseVec3(value);
+                } else if (key == "parent") {
+                    parent = lookup(objectNames, value);
+                } else if (!isLight && key == "rotation") {
+                    rotation = parseVec3(value);
+                } else if (!isLight && key == "scale") {
+                    scale = parseVec3(value);
+                } else if (!isLight && key == "model") {
+                    model = lookup(modelNames, value);
+                } else if (!isLight && key == "texture") {
+                    texture = lookup(textureNames, value);
+                } else if (isLight && key == "intensity") {
+                    intensity = parseFloat(value);
+                } else if (isLight && key == "radius") {
+                    radius = parseFloat(value);
+                } else {
+                    fail("unknown property '" + key + "'");
+                }
+            }
+
+            if (isLight) {
+                // lights keep their radius in scale.x
+                scale.x = radius;
+                scene.lights.push_back(Ocean::SceneLight{index, intensity});
+            }
+            scene.translations.push_back(translation);
+            scene.rotations.push_back(rotation);
+            scene.scales.push_back(scale);
+            scene.colors.push_back(color);
+            scene.models.push_back(model);
+            scene.textures.push_back(texture);
+            scene.parents.push_back(parent);
+        }
+
+        SceneData scene;
+        std::unordered_map<std::string, uint32_t> modelNames;
+        std::unordered_map<std::string, uint32_t> textureNames;
+        std::unordered_map<std::string, uint32_t> objectNames;
+        int lineNumber = 0;
+    };
+
+    // square grid of copies of one model, for testing load times of large scenes
+    SceneData generateGrid(uint32_t objectCount, const std::string &modelPath) {
+        SceneData scene;
+        scene.modelPaths.push_back(modelPath);
+        auto side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(objectCount))));
+        for (uint32_t i = 0; i < objectCount; i++) {
+            scene.translations.emplace_back(static_cast<float>(i % side), 0.f, static_cast<float>(i / side));
+            scene.rotations.emplace_back(0.f);
+            scene.scales.emplace_back(.5f);
+            scene.colors.emplace_back(0.f);
+            scene.models.push_back(0);
+            scene.textures.push_back(SceneData::NO_REFERENCE);
+            scene.parents.push_back(SceneData::NO_REFERENCE);
+        }
+        return scene;
+    }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    try {
+        SceneData scene;
+        std::string output;
+        if (argc == 5 && std::string{argv[1]} == "--generate") {
+            scene = generateGrid(static_cast<uint32_t>(std::stoul(argv[2])), argv[3]);
+            output = argv[4];
+        } else if (argc == 3) {
+            scene = TextSceneParser{}.parse(argv[1]);
+            output = argv[2];
+        } else {
+            std::cerr << "usage: " << argv[0] << " <input.scene> <output.oscene>\n"
+                      << "       " << argv[0] << " --generate <objectCount> <model path> <output.oscene>\n";
+            return EXIT_FAILURE;
+        }
+        scene.writeToFile(output);
+        std::cout << "Wrote " << scene.objectCount() << " objects, " << scene.lights.size() << " lights to "
+                  << output << "\n";
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}